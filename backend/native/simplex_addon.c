@@ -0,0 +1,329 @@
+/*
+ * Node addon around simplex_solve. The solver is compiled in whole, main
+ * excepted, so the addon needs nothing but Node's headers:
+ *
+ *   gcc -O2 -shared -fPIC -pthread -I/usr/include/node -DSIMPLEX_NO_MAIN \
+ *       backend/native/simplex_addon.c -o backend/native/simplex.node -lm
+ *
+ * solve(costs, nutrients, requirements[, { tableaux }]) takes Float64Arrays
+ * (nutrients food by food, n * m) and returns a promise. The solve runs on
+ * the libuv threadpool straight out of the caller's arrays, which must not
+ * change until the promise settles, and writes amounts and shadow prices
+ * into Float64Arrays made up front. It resolves to
+ *
+ *   { status, iterations, totalCost, amounts, shadowPrices }
+ *
+ * plus tableaux (count * rows * cols doubles), rows and cols when tableaux
+ * is set; those solves skip presolve and scaling, as in the solver service.
+ *
+ * Workspaces belong to the addon instance: a solve borrows an idle one, or
+ * makes one, and hands it back, so warm solves stay off the heap and every
+ * workspace is freed when the instance's environment goes away.
+ */
+#include <limits.h>
+#include <node_api.h>
+#include "../../implementations/simplex.c"
+
+#define NUM_INPUTS 3
+#define NUM_OUTPUTS 2
+
+typedef struct {
+    pthread_mutex_t lock;
+    SolverWorkspace** idle;
+    int num_idle;
+    int capacity;
+    int busy;           /* workspaces lent out to solves in flight */
+    int closing;        /* the environment is gone; the last solve back frees the pool */
+} WorkspacePool;
+
+typedef struct {
+    napi_async_work work;
+    WorkspacePool* pool;
+    napi_deferred deferred;
+    napi_ref inputs[NUM_INPUTS];
+    napi_ref outputs[NUM_OUTPUTS];
+    double* costs;
+    double* nutrients;
+    double* requirements;
+    double* amounts;
+    double* shadow_prices;
+    int num_foods;
+    int num_nutrients;
+    int want_tableaux;
+    int failed;
+    SolveStatus status;
+    int iterations;
+    double total_cost;
+    TableauSnapshots snapshots;
+} SolveJob;
+
+static void free_workspace_pool(WorkspacePool* pool) {
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->idle);
+    free(pool);
+}
+
+static SolverWorkspace* borrow_workspace(WorkspacePool* pool, int n, int m) {
+    pthread_mutex_lock(&pool->lock);
+    SolverWorkspace* ws = pool->num_idle ? pool->idle[--pool->num_idle] : NULL;
+    pool->busy++;
+    pthread_mutex_unlock(&pool->lock);
+    return ws ? ws : create_workspace(n, m);
+}
+
+static void return_workspace(WorkspacePool* pool, SolverWorkspace* ws) {
+    pthread_mutex_lock(&pool->lock);
+    pool->busy--;
+    if (ws && !pool->closing && pool->num_idle == pool->capacity) {
+        int capacity = pool->capacity ? 2 * pool->capacity : 4;
+        SolverWorkspace** idle = (SolverWorkspace**)realloc(pool->idle, capacity * sizeof(SolverWorkspace*));
+        if (idle) {
+            pool->idle = idle;
+            pool->capacity = capacity;
+        }
+    }
+    if (ws && !pool->closing && pool->num_idle < pool->capacity) {
+        pool->idle[pool->num_idle++] = ws;
+        ws = NULL;
+    }
+    int last = pool->closing && pool->busy == 0;
+    pthread_mutex_unlock(&pool->lock);
+    free_workspace(ws);
+    if (last) free_workspace_pool(pool);
+}
+
+/* Instance data finalizer: frees the idle workspaces now and the pool once no solve holds one. */
+static void close_workspace_pool(napi_env env, void* data, void* hint) {
+    (void)env;
+    (void)hint;
+    WorkspacePool* pool = (WorkspacePool*)data;
+    pthread_mutex_lock(&pool->lock);
+    pool->closing = 1;
+    for (int k = 0; k < pool->num_idle; k++) free_workspace(pool->idle[k]);
+    pool->num_idle = 0;
+    int last = pool->busy == 0;
+    pthread_mutex_unlock(&pool->lock);
+    if (last) free_workspace_pool(pool);
+}
+
+static void execute_solve(napi_env env, void* data) {
+    (void)env;
+    SolveJob* job = (SolveJob*)data;
+    int n = job->num_foods;
+    int m = job->num_nutrients;
+    SolverWorkspace* ws = borrow_workspace(job->pool, n, m);
+    if (!ws) {
+        job->failed = 1;
+        return_workspace(job->pool, NULL);
+        return;
+    }
+    
+    DietProblem problem = diet_problem_view(n, m, job->costs, job->nutrients, job->requirements);
+    SolverOptions opts = solver_options_default();
+    PivotTrace trace = { snapshot_tableau, &job->snapshots, 0 };
+    job->snapshots.ws = ws;
+    if (job->want_tableaux && reserve_snapshots(&job->snapshots, n, m) == 0) {
+        opts.presolve = 0;
+        opts.scaling = 0;
+        opts.trace = &trace;
+    }
+    Solution* sol = simplex_solve_in(ws, &problem, &opts);
+    if (sol) {
+        job->status = sol->status;
+        job->iterations = sol->iterations;
+        job->total_cost = sol->total_cost;
+        memcpy(job->amounts, sol->amounts, n * sizeof(double));
+        memcpy(job->shadow_prices, sol->shadow_prices, m * sizeof(double));
+    } else {
+        job->failed = 1;
+    }
+    return_workspace(job->pool, ws);
+}
+
+static napi_value make_number(napi_env env, double value) {
+    napi_value v;
+    napi_create_double(env, value, &v);
+    return v;
+}
+
+static void set_field(napi_env env, napi_value object, const char* name, napi_value value) {
+    napi_set_named_property(env, object, name, value);
+}
+
+static napi_value referenced(napi_env env, napi_ref ref) {
+    napi_value v;
+    napi_get_reference_value(env, ref, &v);
+    return v;
+}
+
+static void complete_solve(napi_env env, napi_status status, void* data) {
+    SolveJob* job = (SolveJob*)data;
+    napi_value result;
+    if (status != napi_ok || job->failed) {
+        napi_value message;
+        napi_create_string_utf8(env, "simplex solve failed", NAPI_AUTO_LENGTH, &message);
+        napi_create_error(env, NULL, message, &result);
+        napi_reject_deferred(env, job->deferred, result);
+    } else {
+        napi_value name;
+        napi_create_object(env, &result);
+        napi_create_string_utf8(env, solve_status_name(job->status), NAPI_AUTO_LENGTH, &name);
+        set_field(env, result, "status", name);
+        set_field(env, result, "iterations", make_number(env, job->iterations));
+        set_field(env, result, "totalCost", make_number(env, job->total_cost));
+        set_field(env, result, "amounts", referenced(env, job->outputs[0]));
+        set_field(env, result, "shadowPrices", referenced(env, job->outputs[1]));
+        if (job->want_tableaux) {
+            TableauSnapshots* s = &job->snapshots;
+            size_t cells = (size_t)s->count * s->rows * s->cols;
+            void* bytes;
+            napi_value buffer;
+            napi_value tableaux;
+            napi_create_arraybuffer(env, cells * sizeof(double), &bytes, &buffer);
+            if (cells) memcpy(bytes, s->cells, cells * sizeof(double));
+            napi_create_typedarray(env, napi_float64_array, cells, buffer, 0, &tableaux);
+            set_field(env, result, "tableaux", tableaux);
+            set_field(env, result, "rows", make_number(env, s->rows));
+            set_field(env, result, "cols", make_number(env, s->cols));
+        }
+        napi_resolve_deferred(env, job->deferred, result);
+    }
+    
+    for (int k = 0; k < NUM_INPUTS; k++) napi_delete_reference(env, job->inputs[k]);
+    for (int k = 0; k < NUM_OUTPUTS; k++) napi_delete_reference(env, job->outputs[k]);
+    napi_delete_async_work(env, job->work);
+    free(job->snapshots.cells);
+    free(job);
+}
+
+/* The data of a Float64Array argument and its length; -1 after throwing a TypeError. */
+static int float64_data(napi_env env, napi_value value, const char* what, double** data, size_t* length) {
+    bool is_typed;
+    napi_typedarray_type type;
+    if (napi_is_typedarray(env, value, &is_typed) != napi_ok || !is_typed ||
+        napi_get_typedarray_info(env, value, &type, length, (void**)data, NULL, NULL) != napi_ok ||
+        type != napi_float64_array) {
+        char message[64];
+        snprintf(message, sizeof(message), "%s must be a Float64Array", what);
+        napi_throw_type_error(env, NULL, message);
+        return -1;
+    }
+    return 0;
+}
+
+/* NULL, with *data unset, if the array cannot be made. */
+static napi_value new_float64_array(napi_env env, size_t length, double** data) {
+    napi_value buffer;
+    napi_value array;
+    if (napi_create_arraybuffer(env, length * sizeof(double), (void**)data, &buffer) != napi_ok ||
+        napi_create_typedarray(env, napi_float64_array, length, buffer, 0, &array) != napi_ok) {
+        return NULL;
+    }
+    return array;
+}
+
+/* Drops whatever references a job holds so far and frees it; used when queueing fails. */
+static void discard_job(napi_env env, SolveJob* job) {
+    for (int k = 0; k < NUM_INPUTS; k++) {
+        if (job->inputs[k]) napi_delete_reference(env, job->inputs[k]);
+    }
+    for (int k = 0; k < NUM_OUTPUTS; k++) {
+        if (job->outputs[k]) napi_delete_reference(env, job->outputs[k]);
+    }
+    if (job->work) napi_delete_async_work(env, job->work);
+    free(job);
+}
+
+static napi_value solve(napi_env env, napi_callback_info info) {
+    size_t argc = 4;
+    napi_value argv[4];
+    napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+    if (argc < NUM_INPUTS) {
+        napi_throw_type_error(env, NULL, "solve(costs, nutrients, requirements[, options])");
+        return NULL;
+    }
+    
+    size_t n, nm, m;
+    double* costs;
+    double* nutrients;
+    double* requirements;
+    if (float64_data(env, argv[0], "costs", &costs, &n) != 0 ||
+        float64_data(env, argv[1], "nutrients", &nutrients, &nm) != 0 ||
+        float64_data(env, argv[2], "requirements", &requirements, &m) != 0) {
+        return NULL;
+    }
+    if (!n || !m || nm / n != m || nm % n || n > INT_MAX || m > INT_MAX) {
+        napi_throw_range_error(env, NULL, "expected n costs, n * m nutrients and m requirements");
+        return NULL;
+    }
+    
+    SolveJob* job = (SolveJob*)calloc(1, sizeof(SolveJob));
+    if (!job) {
+        napi_throw_error(env, NULL, "out of memory");
+        return NULL;
+    }
+    napi_get_instance_data(env, (void**)&job->pool);
+    job->costs = costs;
+    job->nutrients = nutrients;
+    job->requirements = requirements;
+    job->num_foods = (int)n;
+    job->num_nutrients = (int)m;
+    if (argc > 3) {
+        napi_valuetype type;
+        napi_value flag;
+        bool want = false;
+        napi_typeof(env, argv[3], &type);
+        if (type == napi_object && napi_get_named_property(env, argv[3], "tableaux", &flag) == napi_ok) {
+            napi_coerce_to_bool(env, flag, &flag);
+            napi_get_value_bool(env, flag, &want);
+        }
+        job->want_tableaux = want;
+    }
+    
+    /* References keep the inputs and outputs alive while the threadpool works on their memory. */
+    napi_value outputs[NUM_OUTPUTS] = {
+        new_float64_array(env, n, &job->amounts),
+        new_float64_array(env, m, &job->shadow_prices)
+    };
+    int ok = outputs[0] && outputs[1];
+    for (int k = 0; ok && k < NUM_INPUTS; k++) {
+        ok = napi_create_reference(env, argv[k], 1, &job->inputs[k]) == napi_ok;
+    }
+    for (int k = 0; ok && k < NUM_OUTPUTS; k++) {
+        ok = napi_create_reference(env, outputs[k], 1, &job->outputs[k]) == napi_ok;
+    }
+    
+    napi_value promise;
+    napi_value name;
+    ok = ok && napi_create_string_utf8(env, "simplex_solve", NAPI_AUTO_LENGTH, &name) == napi_ok &&
+         napi_create_async_work(env, NULL, name, execute_solve, complete_solve, job, &job->work) == napi_ok &&
+         napi_create_promise(env, &job->deferred, &promise) == napi_ok;
+    if (!ok || napi_queue_async_work(env, job->work) != napi_ok) {
+        /* The promise is never handed out; settling it quietly releases the deferred. */
+        if (job->deferred) {
+            napi_value undefined;
+            napi_get_undefined(env, &undefined);
+            napi_resolve_deferred(env, job->deferred, undefined);
+        }
+        discard_job(env, job);
+        napi_throw_error(env, NULL, "simplex solve could not be queued");
+        return NULL;
+    }
+    return promise;
+}
+
+static napi_value init(napi_env env, napi_value exports) {
+    WorkspacePool* pool = (WorkspacePool*)calloc(1, sizeof(WorkspacePool));
+    if (!pool || napi_set_instance_data(env, pool, close_workspace_pool, NULL) != napi_ok) {
+        free(pool);
+        napi_throw_error(env, NULL, "out of memory");
+        return NULL;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    napi_value fn;
+    napi_create_function(env, "solve", NAPI_AUTO_LENGTH, solve, NULL, &fn);
+    napi_set_named_property(env, exports, "solve", fn);
+    return exports;
+}
+
+NAPI_MODULE(simplex, init)
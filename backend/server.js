@@ -1,9 +1,22 @@
 const express = require('express');
 const cors = require('cors');
 const bodyParser = require('body-parser');
+const net = require('net');
 
 const app = express();
 const PORT = 3000;
+// Unix socket of the native solver (`simplex-c --serve=PATH`); unset solves in-process.
+const SIMPLEX_SOCKET = process.env.SIMPLEX_SOCKET;
+// A solver connection that stays silent this long is dropped and the request answered 503.
+const SIMPLEX_TIMEOUT_MS = Number(process.env.SIMPLEX_TIMEOUT_MS) || 10000;
+
+// In-process native solver (backend/native/simplex_addon.c); without it the JavaScript tableau solves.
+let simplexAddon = null;
+try {
+    simplexAddon = require('./native/simplex.node');
+} catch (error) {
+    simplexAddon = null;
+}
 
 app.use(cors());
 app.use(bodyParser.json());
@@ -71,7 +84,41 @@ class Tableau {
     }
 }
 
-function simplexSolve(foods, constraints) {
+// Every solver path answers in this shape; `error` is set whenever the status is not optimal.
+function solveResult(status, amounts, totalCost, shadowPrices, iterations) {
+    const result = { status, feasible: status === 'optimal', amounts, totalCost, shadowPrices };
+    if (iterations) result.iterations = iterations;
+    if (status !== 'optimal') result.error = `Problem is ${status}`;
+    return result;
+}
+
+// Native snapshots (count x rows x cols doubles) as tableauSolve's iterations. The
+// native tableau carries surplus columns as +1 where tableauSolve writes -1, so those
+// columns are negated; the pivots themselves are the native solver's.
+function nativeIterations(cells, rows, cols, numFoods) {
+    const numSlack = rows - 1;
+    const iterations = [];
+    for (let t = 0; t + rows * cols <= cells.length; t += rows * cols) {
+        const matrix = [];
+        for (let i = 0; i < rows; i++) {
+            const row = Array.from(cells.subarray(t + i * cols, t + (i + 1) * cols));
+            for (let j = numFoods; j < numFoods + numSlack; j++) row[j] = -row[j] || 0;
+            matrix.push(row);
+        }
+        iterations.push(matrix);
+    }
+    return iterations;
+}
+
+function shadowPriceMap(keys, prices) {
+    const shadowPrices = {};
+    keys.forEach((key, i) => {
+        shadowPrices[key] = prices[i];
+    });
+    return shadowPrices;
+}
+
+function tableauSolve(foods, constraints, wantIterations) {
     const numFoods = foods.length;
     const numConstraints = 5;
     const constraintKeys = ['protein', 'carbs', 'fat', 'fiber', 'vitamins'];
@@ -100,15 +147,20 @@ function simplexSolve(foods, constraints) {
     const maxIterations = 100;
     const iterations = [];
 
+    let status = 'iteration limit';
+
     while (iteration < maxIterations) {
-        iterations.push(JSON.parse(JSON.stringify(tableau.matrix)));
+        if (wantIterations) iterations.push(JSON.parse(JSON.stringify(tableau.matrix)));
 
         const pivotCol = tableau.findPivotColumn();
-        if (pivotCol === -1) break;
+        if (pivotCol === -1) {
+            status = 'optimal';
+            break;
+        }
 
         const pivotRow = tableau.findPivotRow(pivotCol);
         if (pivotRow === -1) {
-            return { error: 'Problem is unbounded' };
+            return solveResult('unbounded', Array(numFoods).fill(0), null, {}, wantIterations && iterations);
         }
 
         tableau.pivot(pivotRow, pivotCol);
@@ -151,18 +203,139 @@ function simplexSolve(foods, constraints) {
         shadowPrices[key] = Math.abs(tableau.matrix[totalRows - 1][numVars + i]);
     });
 
-    return {
-        amounts,
-        totalCost,
-        shadowPrices,
-        iterations,
-        feasible: true
+    return solveResult(status, amounts, totalCost, shadowPrices, wantIterations && iterations);
+}
+
+async function simplexSolve(foods, constraints, wantIterations) {
+    if (!simplexAddon) return tableauSolve(foods, constraints, wantIterations);
+
+    const keys = ['protein', 'carbs', 'fat', 'fiber', 'vitamins'];
+    const n = foods.length;
+    const m = keys.length;
+    const costs = new Float64Array(n);
+    const nutrients = new Float64Array(n * m);
+    foods.forEach((food, j) => {
+        costs[j] = Number(food.cost) || 0;
+        keys.forEach((key, i) => {
+            nutrients[j * m + i] = Number(food[key]) || 0;
+        });
+    });
+    const requirements = Float64Array.from(keys, key => constraints[key]);
+
+    const result = await simplexAddon.solve(costs, nutrients, requirements, { tableaux: Boolean(wantIterations) });
+    const iterations = wantIterations && nativeIterations(result.tableaux, result.rows, result.cols, n);
+    return solveResult(result.status, Array.from(result.amounts), result.totalCost,
+        shadowPriceMap(keys, result.shadowPrices), iterations);
+}
+
+// Frame layout and status codes mirror the solver service in implementations/simplex.c.
+const SERVE_MAGIC = 0x54454944;
+const SERVE_TABLEAUX = 1;
+const SERVE_BUSY = -2;
+const SOLVE_STATUS = ['optimal', 'infeasible', 'unbounded', 'iteration limit', 'time limit', 'numerical error'];
+
+function encodeRequest(foods, constraints, keys, wantIterations) {
+    const n = foods.length;
+    const m = keys.length;
+    const payload = 16 + 8 * (n + n * m + m);
+    const buf = Buffer.alloc(8 + payload);
+    buf.writeUInt32LE(SERVE_MAGIC, 0);
+    buf.writeUInt32LE(payload, 4);
+    buf.writeInt32LE(n, 8);
+    buf.writeInt32LE(m, 12);
+    buf.writeInt32LE(wantIterations ? SERVE_TABLEAUX : 0, 16);
+
+    let offset = 24;
+    const put = (value) => {
+        buf.writeDoubleLE(Number(value) || 0, offset);
+        offset += 8;
     };
+    foods.forEach(food => put(food.cost));
+    foods.forEach(food => keys.forEach(key => put(food[key])));
+    keys.forEach(key => put(constraints[key]));
+    return buf;
+}
+
+function decodeResponse(buf, keys) {
+    const status = buf.readInt32LE(0);
+    if (status < 0) {
+        const error = new Error(status === SERVE_BUSY ? 'Solver is busy' : 'Solver rejected the request');
+        error.busy = status === SERVE_BUSY;
+        throw error;
+    }
+    const n = buf.readInt32LE(8);
+    const m = buf.readInt32LE(12);
+    const totalCost = buf.readDoubleLE(16);
+    let offset = 24;
+    const take = (count) => {
+        const values = [];
+        for (let k = 0; k < count; k++, offset += 8) values.push(buf.readDoubleLE(offset));
+        return values;
+    };
+    const amounts = take(n);
+    const prices = take(m);
+
+    let iterations = null;
+    if (offset < buf.length) {
+        const count = buf.readInt32LE(offset);
+        const rows = buf.readInt32LE(offset + 4);
+        const cols = buf.readInt32LE(offset + 8);
+        offset += 16;
+        iterations = nativeIterations(Float64Array.from(take(count * rows * cols)), rows, cols, n);
+    }
+    return solveResult(SOLVE_STATUS[status] || 'unsolved', amounts, totalCost, shadowPriceMap(keys, prices), iterations);
+}
+
+// One connection per solve: the service gives a connection to a worker until it closes.
+function nativeSolve(foods, constraints, wantIterations) {
+    const keys = ['protein', 'carbs', 'fat', 'fiber', 'vitamins'];
+    return new Promise((resolve, reject) => {
+        const socket = net.createConnection(SIMPLEX_SOCKET);
+        const chunks = [];
+        let received = 0;
+        let settled = false;
+        const settle = (fn, value) => {
+            if (settled) return;
+            settled = true;
+            fn(value);
+        };
+        socket.setTimeout(SIMPLEX_TIMEOUT_MS, () => {
+            const error = new Error('Solver timed out');
+            error.busy = true;
+            socket.destroy();
+            settle(reject, error);
+        });
+        socket.on('connect', () => socket.write(encodeRequest(foods, constraints, keys, wantIterations)));
+        socket.on('data', (chunk) => {
+            chunks.push(chunk);
+            received += chunk.length;
+            const buf = chunks.length === 1 ? chunks[0] : Buffer.concat(chunks);
+            if (received < 8 || received < 8 + buf.readUInt32LE(4)) return;
+            socket.end();
+            try {
+                settle(resolve, decodeResponse(buf.subarray(8, 8 + buf.readUInt32LE(4)), keys));
+            } catch (error) {
+                settle(reject, error);
+            }
+        });
+        socket.on('error', (error) => {
+            // A full backlog refuses the connect; a full queue answers busy and may close before our write.
+            error.busy = error.code === 'EAGAIN' || error.code === 'EPIPE';
+            settle(reject, error);
+        });
+        socket.on('close', () => settle(reject, new Error('Solver closed the connection')));
+    });
+}
+
+// Tableau snapshots cost a copy per pivot, so they are only taken when the client asks for iterations.
+function solve(foods, constraints, wantIterations) {
+    return SIMPLEX_SOCKET ? nativeSolve(foods, constraints, wantIterations)
+                          : simplexSolve(foods, constraints, wantIterations);
 }
 
-app.post('/api/optimize', (req, res) => {
+app.post('/api/optimize', async (req, res) => {
     try {
-        const { foods, constraints } = req.body;
+        const { foods, constraints, iterations } = req.body;
 
         if (!foods || !constraints) {
             return res.status(400).json({ error: 'Missing foods or constraints' });
@@ -179,7 +352,7 @@ app.post('/api/optimize', (req, res) => {
             }
         }
 
-        const result = simplexSolve(foods, constraints);
+        const result = await solve(foods, constraints, iterations === true);
 
         if (result.error) {
             return res.status(400).json(result);
@@ -187,6 +360,7 @@ app.post('/api/optimize', (req, res) => {
 
         res.json(result);
     } catch (error) {
+        if (error.busy) return res.status(503).json({ error: 'Solver is busy, try again' });
         console.error('Optimization error:', error);
         res.status(500).json({ error: 'Internal server error', message: error.message });
     }
@@ -235,7 +409,7 @@ app.post('/api/sensitivity', (req, res) => {
     }
 });
 
-app.post('/api/dual', (req, res) => {
+app.post('/api/dual', async (req, res) => {
     try {
         const { foods, constraints } = req.body;
 
@@ -243,7 +417,7 @@ app.post('/api/dual', (req, res) => {
             return res.status(400).json({ error: 'Missing foods or constraints' });
         }
 
-        const result = simplexSolve(foods, constraints);
+        const result = await solve(foods, constraints, false);
 
         if (result.error) {
             return res.status(400).json(result);
@@ -270,6 +444,7 @@ app.post('/api/dual', (req, res) => {
 
         res.json(dualProblem);
     } catch (error) {
+        if (error.busy) return res.status(503).json({ error: 'Solver is busy, try again' });
         console.error('Dual problem error:', error);
         res.status(500).json({ error: 'Internal server error', message: error.message });
     }
@@ -283,6 +458,7 @@ app.listen(PORT, () => {
 ╚════════════════════════════════════════════════════════╝
 
 Server running on http://localhost:${PORT}
+Solver: ${SIMPLEX_SOCKET ? `native service at ${SIMPLEX_SOCKET}` : simplexAddon ? 'native addon' : 'in-process JavaScript'}
 
 Available endpoints:
   POST /api/optimize     - Solve the diet optimization problem
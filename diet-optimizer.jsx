@@ -24,7 +24,7 @@ interface Solution {
   amounts: number[];
   totalCost: number;
   shadowPrices: {[key: string]: number};
-  iterations: number[][];
+  iterations?: number[][];
   feasible: boolean;
 }
 
@@ -141,7 +141,7 @@ interface Solution {
 
         <!-- Developer Panel -->
         <div class="developer-panel">
-          <button class="btn-secondary" (click)="showDeveloper = !showDeveloper">
+          <button class="btn-secondary" (click)="toggleDeveloper()">
             {{ showDeveloper ? '▼ Hide' : '▶ Show' }} Developer Control Panel
           </button>
           <div *ngIf="showDeveloper && solution.iterations" class="tableau-viewer">
@@ -551,6 +551,14 @@ export class AppComponent implements OnInit {
     this.foods = this.foods.filter(f => f.id !== id);
   }
 
+  // The server only sends tableau iterations on request, so opening the panel re-solves once.
+  toggleDeveloper() {
+    this.showDeveloper = !this.showDeveloper;
+    if (this.showDeveloper && this.solution && !this.solution.iterations) {
+      this.optimize();
+    }
+  }
+
   optimize() {
     this.loading = true;
     this.error = null;
@@ -558,7 +566,8 @@ export class AppComponent implements OnInit {
 
     const payload = {
       foods: this.foods,
-      constraints: this.constraints
+      constraints: this.constraints,
+      iterations: this.showDeveloper
     };
 
     this.http.post<Solution>('http://localhost:3000/api/optimize', payload)
@@ -2,275 +2,5971 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SIMPLEX_X86 1
+#include <immintrin.h>
+#else
+#define SIMPLEX_X86 0
+#endif
 
-#define MAX_FOODS 50
 #define MAX_CONSTRAINTS 10
 #define EPSILON 1e-6
+#define TABLEAU_ALIGNMENT 64
+
+/* Fixed-size food record used for small, statically initialized catalogues. */
+typedef struct {
+    char name[50];
+    double cost;
+    double nutrients[MAX_CONSTRAINTS];
+} Food;
+
+typedef struct {
+    char* chars;
+    size_t length;
+    size_t capacity;
+    int* slots;
+    int num_slots;
+    int count;
+} NameTable;
+
+/*
+ * Dynamically sized diet problem. Costs, requirements and the nutrient matrix
+ * share one allocation; names are interned into a separate table and
+ * referenced by offset so the solver never touches them.
+ *
+ * The matrix is stored either dense column-major in `nutrients` (food j's
+ * nutrients are contiguous) or, when `nutrients` is NULL, in compressed
+ * sparse column form: food j's nonzeros are values[col_start[j] ..
+ * col_start[j+1]) at rows row_index[...].
+ */
+typedef struct {
+    int num_foods;
+    int num_nutrients;
+    double* costs;
+    double* requirements;
+    double* nutrients;
+    int* col_start;
+    int* row_index;
+    double* values;
+    int nnz;
+    int* food_names;
+    int* nutrient_names;
+    NameTable names;
+} DietProblem;
+
+static inline double* food_column(const DietProblem* p, int food) {
+    return p->nutrients + (size_t)food * p->num_nutrients;
+}
+
+/* row[j] -= factor * prow[j] for j < cols; see the row elimination kernels. */
+typedef void (*EliminateKernel)(double* restrict row, const double* restrict prow, double factor, int cols);
+
+/*
+ * The whole tableau lives in one 64-byte aligned block: the header, the basis
+ * array and a row-major matrix whose rows are padded to `stride` doubles so
+ * every row starts on a cache line. eliminate is the kernel its pivots use,
+ * NULL for the widest one the CPU supports.
+ */
+typedef struct {
+    double* data;
+    int rows;
+    int cols;
+    int stride;
+    int* basis;
+    EliminateKernel eliminate;
+} Tableau;
+
+#define TABLEAU_AT(t, i, j) ((t)->data[(size_t)(i) * (t)->stride + (j)])
+
+typedef enum {
+    SOLVE_OPTIMAL,
+    SOLVE_INFEASIBLE,
+    SOLVE_UNBOUNDED,
+    SOLVE_ITERATION_LIMIT,
+    SOLVE_TIME_LIMIT,
+    SOLVE_NUMERICAL_ERROR
+} SolveStatus;
+
+/*
+ * What presolve removed before the engines ran; num_foods, num_nutrients and
+ * nnz are the sizes of the reduced problem. All zero when presolve was off.
+ */
+typedef struct {
+    int num_foods;
+    int num_nutrients;
+    int nnz;
+    int dominated_foods;
+    int duplicate_foods;
+    int empty_foods;
+    int free_singleton_foods;
+    int redundant_nutrients;
+    int singleton_nutrients;
+    long long elapsed_ns;
+} PresolveStats;
+
+/*
+ * Conditioning of the matrix the engine saw: range_before and range_after are
+ * max |a_ij| / min |a_ij| over the nonzeros before and after scaling. All
+ * zero when scaling was off.
+ */
+typedef struct {
+    double range_before;
+    double range_after;
+    int passes;
+    long long elapsed_ns;
+} ScalingStats;
+
+/* The phases SolveStats splits a solve into. */
+typedef enum {
+    PHASE_PRESOLVE,
+    PHASE_SCALING,
+    PHASE_BUILD,        /* tableau fill, or the starting basis and its factorization */
+    PHASE_PRICING,      /* choosing the entering column or leaving row */
+    PHASE_RATIO_TEST,   /* choosing its partner, FTRAN/BTRAN included */
+    PHASE_PIVOT,        /* elimination, or the basis update and refactorizations */
+    PHASE_EXTRACTION,
+    PHASE_POSTSOLVE,
+    PHASE_RANGING,
+    NUM_SOLVE_PHASES
+} SolvePhase;
+
+/*
+ * Where a solve spent its time. cycles[p] counts clock ticks in phase p, TSC
+ * ticks on x86 and nanoseconds elsewhere, and ns[p] converts them with the
+ * solve's own wall time. calls[p] counts the times the phase ran and bytes[p]
+ * estimates the memory it walked, from the extents of the arrays it scans.
+ * All zero when built with -DSIMPLEX_NO_STATS.
+ */
+typedef struct {
+    long long cycles[NUM_SOLVE_PHASES];
+    long long ns[NUM_SOLVE_PHASES];
+    long long calls[NUM_SOLVE_PHASES];
+    long long bytes[NUM_SOLVE_PHASES];
+    long long total_cycles;
+    long long total_ns;
+    int pivots;
+    int degenerate_pivots;
+} SolveStats;
+
+/*
+ * feasible says whether `amounts` meets every requirement. A solve cut short
+ * by a budget still fills in the last basis it reached; primal_bound (cost of
+ * a feasible plan, INFINITY if none is known) and dual_bound (a proven lower
+ * bound, -INFINITY if none) then bracket the optimum. degenerate_pivots
+ * counts the iterations that did not move the objective.
+ *
+ * Ranging, from the optimal basis: food j's price may move within
+ * [cost_lower[j], cost_upper[j]] and nutrient i's requirement within
+ * [requirement_lower[i], requirement_upper[i]], one at a time, before the
+ * basis changes; the bounds may be infinite. Over a requirement range the
+ * shadow price holds. All NAN unless the solve asked for ranging, reached an
+ * optimum and its basis refactorizes cleanly.
+ */
+typedef struct {
+    double* amounts;
+    double total_cost;
+    double* shadow_prices;
+    int feasible;
+    int* basis;
+    double* reduced_costs;
+    int iterations;
+    SolveStatus status;
+    double primal_bound;
+    double dual_bound;
+    int degenerate_pivots;
+    PresolveStats presolve;
+    ScalingStats scaling;
+    SolveStats stats;
+    double* cost_lower;
+    double* cost_upper;
+    double* requirement_lower;
+    double* requirement_upper;
+} Solution;
+
+/* Results of simplex_solve_batch, row k of each flat array belongs to problem k; status holds SolveStatus values. */
+typedef struct {
+    int num_problems;
+    int num_foods;
+    int num_nutrients;
+    double* amounts;
+    double* shadow_prices;
+    double* total_costs;
+    int* status;
+} BatchSolution;
+
+/* Why a cost curve stops where it does. */
+typedef enum {
+    CURVE_LIMIT,          /* reached the caller's bound */
+    CURVE_INFEASIBLE,     /* no diet meets the requirement beyond this point */
+    CURVE_UNBOUNDED,      /* the cost has no lower bound beyond this point */
+    CURVE_PIVOT_LIMIT     /* gave up after PARAMETRIC_MAX_PIVOTS breakpoints */
+} CurveEnd;
+
+/*
+ * The optimal cost as a function of one requirement or one price, exact and
+ * piecewise linear. values[] increase; segment k runs from values[k] to
+ * values[k+1] with slope slopes[k], the shadow price of the nutrient or the
+ * amount of the food bought on it; the last slope is 0. basis_lower and
+ * basis_upper bound the values over which the solved basis stays optimal
+ * (infinite if it never changes in that direction).
+ */
+typedef struct {
+    int num_points;
+    double* values;
+    double* costs;
+    double* slopes;
+    double basis_lower;
+    double basis_upper;
+    CurveEnd lower_end;
+    CurveEnd upper_end;
+} CostCurve;
+
+typedef enum {
+    KERNEL_SCALAR,
+    KERNEL_SSE2,
+    KERNEL_AVX2,
+    KERNEL_AVX512,
+    NUM_KERNELS
+} KernelLevel;
+
+typedef enum {
+    ENGINE_TABLEAU,
+    ENGINE_REVISED
+} SimplexEngine;
+
+typedef enum {
+    PRICING_DANTZIG,
+    PRICING_PARTIAL,
+    PRICING_DEVEX,
+    PRICING_STEEPEST_EDGE,
+    NUM_PRICING_RULES
+} PricingRule;
+
+typedef enum {
+    RATIO_HARRIS,
+    RATIO_TEXTBOOK
+} RatioTest;
+
+typedef enum {
+    DEGENERACY_PERTURB,
+    DEGENERACY_BLAND,
+    DEGENERACY_NONE
+} DegeneracyRule;
+
+typedef struct PivotPool PivotPool;
+typedef struct SolverWorkspace SolverWorkspace;
+
+typedef enum {
+    TRACE_START,
+    TRACE_PIVOT,
+    TRACE_PERTURB,
+    TRACE_UNPERTURB,
+    TRACE_PHASE_ONE_DONE,
+    TRACE_END
+} TraceEventKind;
+
+/*
+ * One step of a solve, as the engine sees it: indices are those of the
+ * presolved, scaled problem the engine was given. phase is 0 for dual
+ * pivots, else 1 or 2; iteration counts pivots made, the pivot included.
+ * objective is the cost of the basis after the event (phase 2 costs, so
+ * perturbations show). status is only meaningful on TRACE_END.
+ *
+ * With deltas on, pivot events carry what replays the pivot. Tableau: column
+ * is the pivot column before the pivot (num_rows entries, objective row
+ * last) and pivot_row the pivot row after it (num_cols entries), so row i
+ * becomes T_i - column[i] * pivot_row and row `row` becomes pivot_row.
+ * Revised: column is B^-1 a_q, the eta column of the basis update, and
+ * pivot_row is NULL. Both pointers are only valid during the callback.
+ */
+typedef struct {
+    TraceEventKind kind;
+    int iteration;
+    int phase;
+    int row;
+    int col;
+    double pivot;
+    double objective;
+    int status;
+    int num_rows;
+    int num_cols;
+    const double* column;
+    const double* pivot_row;
+} PivotEvent;
+
+typedef void (*PivotTraceFn)(const PivotEvent* event, void* user);
+
+typedef struct {
+    PivotTraceFn fn;
+    void* user;
+    int deltas;
+} PivotTrace;
+
+/*
+ * warm_basis, when set, holds m column indices (foods 0..n-1, nutrient
+ * surplus n..n+m-1) such as a previous Solution's basis. The solve then
+ * starts from it on the revised engine: primal simplex if it is still
+ * feasible (cost changes), dual simplex if it is still dual feasible
+ * (requirement changes), otherwise a cold start.
+ *
+ * max_iterations = 0 picks a limit that grows with the problem size, and
+ * time_limit_ns = 0 means no wall-clock budget.
+ *
+ * degeneracy chooses what happens when the solver stalls on degenerate
+ * pivots: perturb the problem and fall back to Bland's rule if that is not
+ * enough, Bland's rule alone, or nothing.
+ *
+ * presolve shrinks the problem before either engine sees it (see the Presolve
+ * section); it is skipped for warm starts, whose basis indexes the full problem.
+ * scaling rescales the rows and columns of whatever matrix the engine gets
+ * (see the Scaling section); it keeps the basis, so warm starts are scaled too.
+ *
+ * trace, when set, receives every pivot event (see the Tracing section);
+ * otherwise verbose prints them one line each, and with neither set the
+ * engines skip tracing altogether.
+ *
+ * ranging fills the Solution's price and requirement ranges, which costs a
+ * refactorization of the optimal basis on top of the solve; off by default.
+ */
+typedef struct {
+    SimplexEngine engine;
+    int verbose;
+    int num_threads;
+    const int* warm_basis;
+    int max_iterations;
+    long long time_limit_ns;
+    PricingRule pricing;
+    RatioTest ratio_test;
+    DegeneracyRule degeneracy;
+    int presolve;
+    int scaling;
+    const PivotTrace* trace;
+    int ranging;
+} SolverOptions;
+
+/* What a NULL opts means: start from these and set only the fields that differ. */
+SolverOptions solver_options_default(void) {
+    SolverOptions opts = { 0 };
+    opts.engine = ENGINE_TABLEAU;
+    opts.num_threads = 1;
+    opts.pricing = PRICING_DANTZIG;
+    opts.ratio_test = RATIO_HARRIS;
+    opts.degeneracy = DEGENERACY_PERTURB;
+    opts.presolve = 1;
+    opts.scaling = 1;
+    return opts;
+}
+
+static size_t round_up(size_t n, size_t align) {
+    return (n + align - 1) / align * align;
+}
+
+static long long monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/*
+ * Instrumentation. The engines charge each phase with STATS_LAP, which reads
+ * the cheapest clock available, adds the ticks since the previous lap to the
+ * phase and restarts the lap. -DSIMPLEX_NO_STATS compiles all of it away.
+ */
+#ifndef SIMPLEX_NO_STATS
+#define SIMPLEX_STATS 1
+#else
+#define SIMPLEX_STATS 0
+#endif
+
+#if SIMPLEX_STATS
+static inline long long stats_clock(void) {
+#if SIMPLEX_X86
+    return (long long)__rdtsc();
+#else
+    return monotonic_ns();
+#endif
+}
+
+static inline long long stats_lap(SolveStats* s, SolvePhase phase, long long since, long long bytes) {
+    long long now = stats_clock();
+    s->cycles[phase] += now - since;
+    s->calls[phase]++;
+    s->bytes[phase] += bytes;
+    return now;
+}
+
+#define STATS_CLOCK() stats_clock()
+#define STATS_LAP(stats, phase, clock, bytes) ((clock) = stats_lap((stats), (phase), (clock), (bytes)))
+#else
+#define STATS_CLOCK() 0LL
+#define STATS_LAP(stats, phase, clock, bytes) ((void)(stats), (void)(clock), (void)(bytes))
+#endif
+
+/* Uniform in [0, 1) from a 64-bit LCG; deterministic for a given seed. */
+static double uniform_random(unsigned long long* state) {
+    *state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (double)(*state >> 11) / 9007199254740992.0;
+}
+
+/*
+ * Per-solve scratch comes from a bump arena owned by the solver workspace.
+ * arena_alloc hands out 64-byte aligned slices of one block. Requests that do
+ * not fit spill into heap chunks that at least double each time; the next
+ * arena_reset frees them and regrows the block to everything the last solve
+ * asked for. After one solve of a given size, solves of that size take
+ * nothing from the heap.
+ */
+typedef struct ArenaSpill {
+    struct ArenaSpill* next;
+    size_t capacity;
+    size_t used;
+} ArenaSpill;
+
+typedef struct {
+    unsigned char* block;
+    size_t capacity;
+    size_t used;
+    size_t requested;       /* bytes asked for since the last reset, spills included */
+    ArenaSpill* spills;
+    long heap_allocations;  /* blocks ever taken from the heap */
+} Arena;
+
+static void* arena_alloc(Arena* a, size_t bytes) {
+    bytes = round_up(bytes ? bytes : 1, TABLEAU_ALIGNMENT);
+    a->requested += bytes;
+    if (a->used + bytes <= a->capacity) {
+        void* p = a->block + a->used;
+        a->used += bytes;
+        return p;
+    }
+    
+    size_t header_bytes = round_up(sizeof(ArenaSpill), TABLEAU_ALIGNMENT);
+    ArenaSpill* spill = a->spills;
+    if (!spill || spill->used + bytes > spill->capacity) {
+        size_t capacity = spill ? 2 * spill->capacity : round_up(a->capacity + 4096, TABLEAU_ALIGNMENT);
+        if (capacity < bytes) capacity = bytes;
+        spill = (ArenaSpill*)aligned_alloc(TABLEAU_ALIGNMENT, header_bytes + capacity);
+        if (!spill) return NULL;
+        a->heap_allocations++;
+        spill->next = a->spills;
+        spill->capacity = capacity;
+        spill->used = 0;
+        a->spills = spill;
+    }
+    void* p = (unsigned char*)spill + header_bytes + spill->used;
+    spill->used += bytes;
+    return p;
+}
+
+static void* arena_calloc(Arena* a, size_t bytes) {
+    void* p = arena_alloc(a, bytes);
+    if (p) memset(p, 0, bytes);
+    return p;
+}
+
+static void free_arena_spills(Arena* a) {
+    while (a->spills) {
+        ArenaSpill* next = a->spills->next;
+        free(a->spills);
+        a->spills = next;
+    }
+}
+
+/* Releases everything handed out; the memory stays with the arena for the next solve. */
+static void arena_reset(Arena* a) {
+    if (a->spills) {
+        free_arena_spills(a);
+        free(a->block);
+        a->block = (unsigned char*)aligned_alloc(TABLEAU_ALIGNMENT, a->requested);
+        a->capacity = a->block ? a->requested : 0;
+        if (a->block) a->heap_allocations++;
+    }
+    a->used = 0;
+    a->requested = 0;
+}
+
+static void free_arena(Arena* a) {
+    free_arena_spills(a);
+    free(a->block);
+    a->block = NULL;
+    a->capacity = 0;
+    a->used = 0;
+    a->requested = 0;
+}
+
+static inline double* tableau_row(Tableau* t, int i) {
+    return t->data + (size_t)i * t->stride;
+}
+
+static size_t tableau_stride(int cols) {
+    size_t line = TABLEAU_ALIGNMENT / sizeof(double);
+    size_t stride = round_up((size_t)cols, line);
+    /* An odd number of cache lines per row keeps rows off the same 4K offsets. */
+    if ((stride / line) % 2 == 0) stride += line;
+    return stride;
+}
+
+static size_t tableau_bytes(int rows, int cols) {
+    return round_up(sizeof(Tableau), TABLEAU_ALIGNMENT) + round_up((size_t)rows * sizeof(int), TABLEAU_ALIGNMENT) +
+           (size_t)rows * tableau_stride(cols) * sizeof(double);
+}
+
+/* Lays a tableau out in `block`, which must hold tableau_bytes(rows, cols) and be 64-byte aligned. */
+static Tableau* init_tableau(unsigned char* block, int rows, int cols) {
+    size_t stride = tableau_stride(cols);
+    size_t header_bytes = round_up(sizeof(Tableau), TABLEAU_ALIGNMENT);
+    size_t basis_bytes = round_up((size_t)rows * sizeof(int), TABLEAU_ALIGNMENT);
+    size_t matrix_bytes = (size_t)rows * stride * sizeof(double);
+
+    Tableau* t = (Tableau*)block;
+    t->rows = rows;
+    t->cols = cols;
+    t->stride = (int)stride;
+    t->basis = (int*)(block + header_bytes);
+    t->data = (double*)(block + header_bytes + basis_bytes);
+    t->eliminate = NULL;
+    memset(t->data, 0, matrix_bytes);
+    return t;
+}
+
+Tableau* create_tableau(int rows, int cols) {
+    unsigned char* block = (unsigned char*)aligned_alloc(TABLEAU_ALIGNMENT, tableau_bytes(rows, cols));
+    if (!block) return NULL;
+    return init_tableau(block, rows, cols);
+}
+
+static Tableau* arena_tableau(Arena* a, int rows, int cols) {
+    unsigned char* block = (unsigned char*)arena_alloc(a, tableau_bytes(rows, cols));
+    if (!block) return NULL;
+    return init_tableau(block, rows, cols);
+}
+
+void free_tableau(Tableau* t) {
+    free(t);
+}
+
+void free_solution(Solution* sol) {
+    free(sol->amounts);
+    free(sol->shadow_prices);
+    free(sol->basis);
+    free(sol->reduced_costs);
+    free(sol->cost_lower);
+    free(sol->cost_upper);
+    free(sol->requirement_lower);
+    free(sol->requirement_upper);
+    free(sol);
+}
+
+/* NULL if any of its arrays cannot be allocated. */
+Solution* create_solution(int num_foods, int num_constraints) {
+    Solution* sol = (Solution*)malloc(sizeof(Solution));
+    if (!sol) return NULL;
+    sol->amounts = (double*)calloc(num_foods, sizeof(double));
+    sol->shadow_prices = (double*)calloc(num_constraints, sizeof(double));
+    sol->basis = (int*)calloc(num_constraints, sizeof(int));
+    sol->reduced_costs = (double*)calloc(num_foods, sizeof(double));
+    sol->cost_lower = (double*)calloc(num_foods, sizeof(double));
+    sol->cost_upper = (double*)calloc(num_foods, sizeof(double));
+    sol->requirement_lower = (double*)calloc(num_constraints, sizeof(double));
+    sol->requirement_upper = (double*)calloc(num_constraints, sizeof(double));
+    if (!sol->amounts || !sol->shadow_prices || !sol->basis || !sol->reduced_costs || !sol->cost_lower ||
+        !sol->cost_upper || !sol->requirement_lower || !sol->requirement_upper) {
+        free_solution(sol);
+        return NULL;
+    }
+    sol->total_cost = 0.0;
+    sol->feasible = 1;
+    sol->iterations = 0;
+    sol->status = SOLVE_OPTIMAL;
+    sol->primal_bound = 0.0;
+    sol->dual_bound = 0.0;
+    sol->degenerate_pivots = 0;
+    memset(&sol->presolve, 0, sizeof(PresolveStats));
+    memset(&sol->scaling, 0, sizeof(ScalingStats));
+    memset(&sol->stats, 0, sizeof(SolveStats));
+    return sol;
+}
+
+/* A zeroed Solution carved from `a`; it lives until the arena is reset. */
+static Solution* arena_solution(Arena* a, int num_foods, int num_constraints) {
+    Solution* sol = (Solution*)arena_calloc(a, sizeof(Solution));
+    if (!sol) return NULL;
+    sol->amounts = (double*)arena_calloc(a, num_foods * sizeof(double));
+    sol->shadow_prices = (double*)arena_calloc(a, num_constraints * sizeof(double));
+    sol->basis = (int*)arena_calloc(a, num_constraints * sizeof(int));
+    sol->reduced_costs = (double*)arena_calloc(a, num_foods * sizeof(double));
+    sol->cost_lower = (double*)arena_calloc(a, num_foods * sizeof(double));
+    sol->cost_upper = (double*)arena_calloc(a, num_foods * sizeof(double));
+    sol->requirement_lower = (double*)arena_calloc(a, num_constraints * sizeof(double));
+    sol->requirement_upper = (double*)arena_calloc(a, num_constraints * sizeof(double));
+    if (!sol->amounts || !sol->shadow_prices || !sol->basis || !sol->reduced_costs || !sol->cost_lower ||
+        !sol->cost_upper || !sol->requirement_lower || !sol->requirement_upper) {
+        return NULL;
+    }
+    sol->feasible = 1;
+    sol->status = SOLVE_OPTIMAL;
+    return sol;
+}
+
+/* A heap copy of `src` that the caller frees with free_solution; NULL if out of memory. */
+Solution* copy_solution(const Solution* src, int num_foods, int num_constraints) {
+    Solution* sol = create_solution(num_foods, num_constraints);
+    if (!sol) return NULL;
+    double* amounts = sol->amounts;
+    double* shadow_prices = sol->shadow_prices;
+    int* basis = sol->basis;
+    double* reduced_costs = sol->reduced_costs;
+    double* cost_lower = sol->cost_lower;
+    double* cost_upper = sol->cost_upper;
+    double* requirement_lower = sol->requirement_lower;
+    double* requirement_upper = sol->requirement_upper;
+    *sol = *src;
+    sol->amounts = (double*)memcpy(amounts, src->amounts, num_foods * sizeof(double));
+    sol->shadow_prices = (double*)memcpy(shadow_prices, src->shadow_prices, num_constraints * sizeof(double));
+    sol->basis = (int*)memcpy(basis, src->basis, num_constraints * sizeof(int));
+    sol->reduced_costs = (double*)memcpy(reduced_costs, src->reduced_costs, num_foods * sizeof(double));
+    sol->cost_lower = (double*)memcpy(cost_lower, src->cost_lower, num_foods * sizeof(double));
+    sol->cost_upper = (double*)memcpy(cost_upper, src->cost_upper, num_foods * sizeof(double));
+    sol->requirement_lower = (double*)memcpy(requirement_lower, src->requirement_lower,
+                                             num_constraints * sizeof(double));
+    sol->requirement_upper = (double*)memcpy(requirement_upper, src->requirement_upper,
+                                             num_constraints * sizeof(double));
+    return sol;
+}
+
+static int name_hash(const char* s) {
+    unsigned int h = 2166136261u;
+    for (; *s; s++) h = (h ^ (unsigned char)*s) * 16777619u;
+    return (int)(h & 0x7fffffff);
+}
+
+/* -1, leaving the table as it was, if the new slots cannot be allocated. */
+static int name_table_grow_slots(NameTable* names) {
+    int num_slots = names->num_slots ? names->num_slots * 2 : 64;
+    int* slots = (int*)malloc(num_slots * sizeof(int));
+    if (!slots) return -1;
+    for (int i = 0; i < num_slots; i++) slots[i] = -1;
+    
+    for (int i = 0; i < names->num_slots; i++) {
+        int offset = names->slots[i];
+        if (offset < 0) continue;
+        int h = name_hash(names->chars + offset) & (num_slots - 1);
+        while (slots[h] >= 0) h = (h + 1) & (num_slots - 1);
+        slots[h] = offset;
+    }
+    free(names->slots);
+    names->slots = slots;
+    names->num_slots = num_slots;
+    return 0;
+}
+
+/*
+ * Returns the offset of `name` in the table, adding it only if it is not
+ * already present; -1 if out of memory.
+ */
+int intern_name(NameTable* names, const char* name) {
+    if (2 * (names->count + 1) > names->num_slots && name_table_grow_slots(names) != 0) return -1;
+    
+    int h = name_hash(name) & (names->num_slots - 1);
+    while (names->slots[h] >= 0) {
+        if (strcmp(names->chars + names->slots[h], name) == 0) return names->slots[h];
+        h = (h + 1) & (names->num_slots - 1);
+    }
+    
+    size_t len = strlen(name) + 1;
+    if (names->length + len > names->capacity) {
+        size_t capacity = names->capacity ? names->capacity * 2 : 256;
+        while (capacity < names->length + len) capacity *= 2;
+        char* chars = (char*)realloc(names->chars, capacity);
+        if (!chars) return -1;
+        names->chars = chars;
+        names->capacity = capacity;
+    }
+    int offset = (int)names->length;
+    memcpy(names->chars + offset, name, len);
+    names->length += len;
+    names->slots[h] = offset;
+    names->count++;
+    return offset;
+}
+
+static size_t diet_problem_bytes(int num_foods, int num_nutrients, int sparse, int nnz) {
+    size_t matrix_entries = sparse ? (size_t)nnz : (size_t)num_foods * num_nutrients;
+    return round_up(sizeof(DietProblem), sizeof(double)) +
+           ((size_t)num_foods + num_nutrients + matrix_entries) * sizeof(double) +
+           (sparse ? ((size_t)num_foods + 1 + nnz) * sizeof(int) : 0) +
+           ((size_t)num_foods + num_nutrients) * sizeof(int);
+}
+
+/* Lays a problem out in the zeroed `block` of diet_problem_bytes(...) bytes. */
+static DietProblem* init_diet_problem(unsigned char* block, int num_foods, int num_nutrients, int sparse, int nnz) {
+    size_t header_bytes = round_up(sizeof(DietProblem), sizeof(double));
+    size_t matrix_entries = sparse ? (size_t)nnz : (size_t)num_foods * num_nutrients;
+    size_t numeric_bytes = ((size_t)num_foods + num_nutrients + matrix_entries) * sizeof(double);
+    size_t index_bytes = sparse ? ((size_t)num_foods + 1 + nnz) * sizeof(int) : 0;
+    
+    DietProblem* p = (DietProblem*)block;
+    p->num_foods = num_foods;
+    p->num_nutrients = num_nutrients;
+    p->costs = (double*)(block + header_bytes);
+    p->requirements = p->costs + num_foods;
+    if (sparse) {
+        p->values = p->requirements + num_nutrients;
+        p->col_start = (int*)(block + header_bytes + numeric_bytes);
+        p->row_index = p->col_start + num_foods + 1;
+        p->nnz = nnz;
+    } else {
+        p->nutrients = p->requirements + num_nutrients;
+    }
+    p->food_names = (int*)(block + header_bytes + numeric_bytes + index_bytes);
+    p->nutrient_names = p->food_names + num_foods;
+    for (int i = 0; i < num_foods + num_nutrients; i++) p->food_names[i] = -1;
+    return p;
+}
+
+static DietProblem* alloc_diet_problem(int num_foods, int num_nutrients, int sparse, int nnz) {
+    unsigned char* block = (unsigned char*)calloc(1, diet_problem_bytes(num_foods, num_nutrients, sparse, nnz));
+    if (!block) return NULL;
+    return init_diet_problem(block, num_foods, num_nutrients, sparse, nnz);
+}
+
+/* An unnamed problem carved from `a`; never pass it to free_diet_problem. */
+static DietProblem* arena_diet_problem(Arena* a, int num_foods, int num_nutrients, int sparse, int nnz) {
+    unsigned char* block = (unsigned char*)arena_calloc(a, diet_problem_bytes(num_foods, num_nutrients, sparse, nnz));
+    if (!block) return NULL;
+    return init_diet_problem(block, num_foods, num_nutrients, sparse, nnz);
+}
+
+DietProblem* create_diet_problem(int num_foods, int num_nutrients) {
+    return alloc_diet_problem(num_foods, num_nutrients, 0, 0);
+}
+
+/* The caller fills col_start, row_index and values; row indices within a column must be increasing. */
+DietProblem* create_sparse_diet_problem(int num_foods, int num_nutrients, int nnz) {
+    return alloc_diet_problem(num_foods, num_nutrients, 1, nnz);
+}
+
+void free_diet_problem(DietProblem* p) {
+    free(p->names.chars);
+    free(p->names.slots);
+    free(p);
+}
+
+/* Both setters return -1, leaving the old name, if the name table cannot grow. */
+int set_food_name(DietProblem* p, int food, const char* name) {
+    int offset = intern_name(&p->names, name);
+    if (offset < 0) return -1;
+    p->food_names[food] = offset;
+    return 0;
+}
+
+int set_nutrient_name(DietProblem* p, int nutrient, const char* name) {
+    int offset = intern_name(&p->names, name);
+    if (offset < 0) return -1;
+    p->nutrient_names[nutrient] = offset;
+    return 0;
+}
+
+const char* food_name(const DietProblem* p, int food) {
+    return p->food_names[food] < 0 ? "" : p->names.chars + p->food_names[food];
+}
+
+const char* nutrient_name(const DietProblem* p, int nutrient) {
+    return p->nutrient_names[nutrient] < 0 ? "" : p->names.chars + p->nutrient_names[nutrient];
+}
+
+/* Bytes of the constraint matrix in its layout. */
+static size_t matrix_bytes(const DietProblem* p) {
+    if (p->nutrients) return (size_t)p->num_foods * p->num_nutrients * sizeof(double);
+    return (size_t)p->nnz * (sizeof(double) + sizeof(int)) + ((size_t)p->num_foods + 1) * sizeof(int);
+}
+
+static int copied_nnz(const DietProblem* src, int sparse) {
+    if (!sparse) return 0;
+    if (!src->nutrients) return src->nnz;
+    int nnz = 0;
+    for (size_t k = 0; k < (size_t)src->num_foods * src->num_nutrients; k++) {
+        if (src->nutrients[k] != 0.0) nnz++;
+    }
+    return nnz;
+}
+
+/* Copies costs, requirements and the matrix of `src` into `p`, laid out dense or CSC with room for them. */
+static void copy_problem_data(DietProblem* p, const DietProblem* src) {
+    int n = src->num_foods;
+    int m = src->num_nutrients;
+    int sparse = p->nutrients == NULL;
+    memcpy(p->costs, src->costs, n * sizeof(double));
+    memcpy(p->requirements, src->requirements, m * sizeof(double));
+    
+    int k = 0;
+    for (int j = 0; j < n; j++) {
+        if (sparse) p->col_start[j] = k;
+        if (src->nutrients && sparse) {
+            const double* a = food_column(src, j);
+            for (int i = 0; i < m; i++) {
+                if (a[i] != 0.0) {
+                    p->row_index[k] = i;
+                    p->values[k++] = a[i];
+                }
+            }
+        } else if (src->nutrients) {
+            memcpy(food_column(p, j), food_column(src, j), m * sizeof(double));
+        } else {
+            double* dst = sparse ? NULL : food_column(p, j);
+            for (int e = src->col_start[j]; e < src->col_start[j + 1]; e++) {
+                if (sparse) {
+                    p->row_index[k] = src->row_index[e];
+                    p->values[k++] = src->values[e];
+                } else {
+                    dst[src->row_index[e]] = src->values[e];
+                }
+            }
+        }
+    }
+    if (sparse) p->col_start[n] = k;
+}
+
+/* Copies `src` into dense (sparse = 0) or CSC (sparse = 1) storage, dropping zeros in the latter. */
+DietProblem* copy_diet_problem(const DietProblem* src, int sparse) {
+    DietProblem* p = alloc_diet_problem(src->num_foods, src->num_nutrients, sparse, copied_nnz(src, sparse));
+    if (!p) return NULL;
+    copy_problem_data(p, src);
+    
+    for (int j = 0; j < src->num_foods; j++) {
+        if (src->food_names[j] >= 0 && set_food_name(p, j, food_name(src, j)) != 0) {
+            free_diet_problem(p);
+            return NULL;
+        }
+    }
+    for (int i = 0; i < src->num_nutrients; i++) {
+        if (src->nutrient_names[i] >= 0 && set_nutrient_name(p, i, nutrient_name(src, i)) != 0) {
+            free_diet_problem(p);
+            return NULL;
+        }
+    }
+    return p;
+}
+
+/* copy_diet_problem into the arena, without names. */
+static DietProblem* arena_copy_diet_problem(Arena* a, const DietProblem* src, int sparse) {
+    DietProblem* p = arena_diet_problem(a, src->num_foods, src->num_nutrients, sparse, copied_nnz(src, sparse));
+    if (!p) return NULL;
+    copy_problem_data(p, src);
+    return p;
+}
+
+DietProblem* diet_problem_from_foods(Food* foods, int num_foods, double* constraints, int num_constraints) {
+    if (num_constraints > MAX_CONSTRAINTS) return NULL;
+    
+    DietProblem* p = create_diet_problem(num_foods, num_constraints);
+    if (!p) return NULL;
+    
+    for (int j = 0; j < num_foods; j++) {
+        p->costs[j] = foods[j].cost;
+        memcpy(food_column(p, j), foods[j].nutrients, num_constraints * sizeof(double));
+        if (set_food_name(p, j, foods[j].name) != 0) {
+            free_diet_problem(p);
+            return NULL;
+        }
+    }
+    memcpy(p->requirements, constraints, num_constraints * sizeof(double));
+    return p;
+}
+
+void print_tableau(Tableau* t) {
+    printf("\n=== Simplex Tableau ===\n");
+    for (int i = 0; i < t->rows; i++) {
+        for (int j = 0; j < t->cols; j++) {
+            printf("%8.3f ", TABLEAU_AT(t, i, j));
+        }
+        if (i < t->rows - 1) {
+            printf("| Basis: %d", t->basis[i]);
+        }
+        printf("\n");
+    }
+    printf("=======================\n");
+}
+
+int find_pivot_column(Tableau* t) {
+    int pivot_col = -1;
+    double min_val = -EPSILON;
+    double* obj = tableau_row(t, t->rows - 1);
+    
+    for (int j = 0; j < t->cols - 1; j++) {
+        if (obj[j] < min_val) {
+            min_val = obj[j];
+            pivot_col = j;
+        }
+    }
+    
+    return pivot_col;
+}
+
+/*
+ * Ratio tests. The primal tests read basic values x and the entering column
+ * alpha at x[i * stride]; the dual tests read reduced costs d and the pivot
+ * row alpha. The textbook tests take the exact minimum ratio. The Harris
+ * tests bound the step so that nothing becomes more than HARRIS_TOLERANCE
+ * infeasible, then take the largest pivot element among the ratios inside
+ * that bound. Degenerate (zero) ratios are eligible in both.
+ *
+ * The band is absolute, and its effect is multiplied by the row scale, so
+ * it is kept well below EPSILON: 1e-7 already cost up to 1% of the
+ * objective on catalogues whose rows span six orders of magnitude.
+ */
+#define HARRIS_TOLERANCE 1e-9
+
+static int textbook_ratio_test(const double* x, const double* alpha, size_t stride, int count) {
+    int pivot_row = -1;
+    double min_ratio = INFINITY;
+    for (int i = 0; i < count; i++) {
+        double a = alpha[i * stride];
+        if (a > EPSILON) {
+            double ratio = fmax(0.0, x[i * stride]) / a;
+            if (ratio < min_ratio) {
+                min_ratio = ratio;
+                pivot_row = i;
+            }
+        }
+    }
+    return pivot_row;
+}
+
+/*
+ * Two passes over the rows, comparing ratios by cross-multiplying with the
+ * bound kept as num / den. Both passes skip pivots below EPSILON, as the
+ * textbook test does, so a column with none is unbounded in either test.
+ */
+static int harris_ratio_test(const double* x, const double* alpha, size_t stride, int count) {
+    double num = INFINITY;
+    double den = 1.0;
+    for (int i = 0; i < count; i++) {
+        double a = alpha[i * stride];
+        double relaxed = fmax(0.0, x[i * stride]) + HARRIS_TOLERANCE;
+        if (a > EPSILON && relaxed * den < num * a) {
+            num = relaxed;
+            den = a;
+        }
+    }
+    if (num == INFINITY) return -1;
+    
+    int pivot_row = -1;
+    double best = 0.0;
+    for (int i = 0; i < count; i++) {
+        double a = alpha[i * stride];
+        if (a > EPSILON && a > best && fmax(0.0, x[i * stride]) * den <= num * a) {
+            best = a;
+            pivot_row = i;
+        }
+    }
+    return pivot_row;
+}
+
+static int textbook_dual_ratio_test(const double* d, const double* alpha, int count) {
+    int pivot_col = -1;
+    double min_ratio = INFINITY;
+    for (int j = 0; j < count; j++) {
+        if (alpha[j] < -EPSILON) {
+            double ratio = fmax(0.0, d[j]) / -alpha[j];
+            if (ratio < min_ratio || (ratio == min_ratio && alpha[j] < alpha[pivot_col])) {
+                min_ratio = ratio;
+                pivot_col = j;
+            }
+        }
+    }
+    return pivot_col;
+}
+
+/* The same two passes over the columns, with |alpha| of the negative entries as the pivot. */
+static int harris_dual_ratio_test(const double* d, const double* alpha, int count) {
+    double num = INFINITY;
+    double den = 1.0;
+    for (int j = 0; j < count; j++) {
+        double a = -alpha[j];
+        double relaxed = fmax(0.0, d[j]) + HARRIS_TOLERANCE;
+        if (a > EPSILON && relaxed * den < num * a) {
+            num = relaxed;
+            den = a;
+        }
+    }
+    if (num == INFINITY) return -1;
+    
+    int pivot_col = -1;
+    double best = 0.0;
+    for (int j = 0; j < count; j++) {
+        double a = -alpha[j];
+        if (a > EPSILON && a > best && fmax(0.0, d[j]) * den <= num * a) {
+            best = a;
+            pivot_col = j;
+        }
+    }
+    return pivot_col;
+}
+
+int find_pivot_row(Tableau* t, int pivot_col) {
+    return textbook_ratio_test(&TABLEAU_AT(t, 0, t->cols - 1), &TABLEAU_AT(t, 0, pivot_col), t->stride, t->rows - 1);
+}
+
+int find_pivot_row_harris(Tableau* t, int pivot_col) {
+    return harris_ratio_test(&TABLEAU_AT(t, 0, t->cols - 1), &TABLEAU_AT(t, 0, pivot_col), t->stride, t->rows - 1);
+}
+
+/* Dual simplex: the basic variable with the most negative value leaves. */
+int find_dual_pivot_row(Tableau* t) {
+    int pivot_row = -1;
+    double min_rhs = -EPSILON;
+    
+    for (int i = 0; i < t->rows - 1; i++) {
+        double rhs = TABLEAU_AT(t, i, t->cols - 1);
+        if (rhs < min_rhs) {
+            min_rhs = rhs;
+            pivot_row = i;
+        }
+    }
+    
+    return pivot_row;
+}
+
+/* Dual ratio test: the entering column keeps every reduced cost nonnegative. */
+int find_dual_pivot_column(Tableau* t, int pivot_row) {
+    return textbook_dual_ratio_test(tableau_row(t, t->rows - 1), tableau_row(t, pivot_row), t->cols - 1);
+}
+
+int find_dual_pivot_column_harris(Tableau* t, int pivot_row) {
+    return harris_dual_ratio_test(tableau_row(t, t->rows - 1), tableau_row(t, pivot_row), t->cols - 1);
+}
+
+/*
+ * Pricing rules. Dantzig takes the most negative reduced cost (in the dual,
+ * the most negative basic variable). Partial pricing does the same over one
+ * rotating segment of about 4 sqrt(cols) columns at a time; the revised
+ * engine also keeps the best few columns of that segment as candidates and
+ * reprices only those until they run out (multiple pricing), so a pivot
+ * prices far fewer columns than the catalogue holds. Devex and steepest
+ * edge divide the squared infeasibility by a weight: a reference-framework
+ * estimate of the edge norm (Devex) or the exact squared norm (steepest
+ * edge).
+ *
+ * The tableau engine has every column of B^-1 A at hand, and B^-1 itself in
+ * the surplus columns, so its steepest-edge norms are computed exactly as
+ * they are needed. The revised engine keeps them updated instead.
+ */
+#define PARTIAL_PRICING_MIN_SEGMENT 64
+#define PRICING_CANDIDATES 8
+
+typedef struct {
+    PricingRule rule;
+    double* column_weights;
+    double* row_weights;
+    int next_col;
+    int num_candidates;
+    int candidates[PRICING_CANDIDATES];
+} Pricing;
+
+static const char* pricing_names[NUM_PRICING_RULES] = { "dantzig", "partial", "devex", "steepest-edge" };
+static const char* degeneracy_names[] = { "perturb", "bland", "none" };
+
+static void reset_pricing(Pricing* p, PricingRule rule, int num_cols, int num_rows) {
+    p->rule = rule;
+    p->next_col = 0;
+    p->num_candidates = 0;
+    for (int j = 0; j < num_cols; j++) {
+        p->column_weights[j] = 1.0;
+    }
+    for (int i = 0; i < num_rows; i++) {
+        p->row_weights[i] = 1.0;
+    }
+}
+
+static int partial_segment_length(int num_cols) {
+    int length = 4 * (int)sqrt((double)num_cols);
+    return length > PARTIAL_PRICING_MIN_SEGMENT ? length : PARTIAL_PRICING_MIN_SEGMENT;
+}
+
+static double tableau_column_norm(Tableau* t, int col) {
+    double norm = 1.0;
+    for (int i = 0; i < t->rows - 1; i++) {
+        norm += TABLEAU_AT(t, i, col) * TABLEAU_AT(t, i, col);
+    }
+    return norm;
+}
+
+/* Squared norm of row i of B^-1, which the surplus columns hold. */
+static double tableau_inverse_row_norm(Tableau* t, int i) {
+    int first = t->cols - t->rows;
+    double* row = tableau_row(t, i);
+    double norm = 0.0;
+    for (int k = first; k < t->cols - 1; k++) {
+        norm += row[k] * row[k];
+    }
+    return norm;
+}
+
+static int price_tableau_column(Tableau* t, Pricing* p) {
+    int num_cols = t->cols - 1;
+    double* obj = tableau_row(t, t->rows - 1);
+    
+    if (p->rule == PRICING_DANTZIG) return find_pivot_column(t);
+    
+    if (p->rule == PRICING_PARTIAL) {
+        int length = partial_segment_length(num_cols);
+        int start = p->next_col < num_cols ? p->next_col : 0;
+        for (int scanned = 0; scanned < num_cols; scanned += length) {
+            int end = start + length < num_cols ? start + length : num_cols;
+            int pivot_col = -1;
+            double min_val = -EPSILON;
+            for (int j = start; j < end; j++) {
+                if (obj[j] < min_val) {
+                    min_val = obj[j];
+                    pivot_col = j;
+                }
+            }
+            start = end < num_cols ? end : 0;
+            if (pivot_col != -1) {
+                p->next_col = start;
+                return pivot_col;
+            }
+        }
+        return -1;
+    }
+    
+    int pivot_col = -1;
+    double best = 0.0;
+    for (int j = 0; j < num_cols; j++) {
+        if (obj[j] >= -EPSILON) continue;
+        double weight = p->rule == PRICING_STEEPEST_EDGE ? tableau_column_norm(t, j) : p->column_weights[j];
+        double score = obj[j] * obj[j] / weight;
+        if (score > best) {
+            best = score;
+            pivot_col = j;
+        }
+    }
+    return pivot_col;
+}
+
+static int price_tableau_row(Tableau* t, Pricing* p) {
+    if (p->rule == PRICING_DANTZIG || p->rule == PRICING_PARTIAL) return find_dual_pivot_row(t);
+    
+    int pivot_row = -1;
+    double best = 0.0;
+    for (int i = 0; i < t->rows - 1; i++) {
+        double rhs = TABLEAU_AT(t, i, t->cols - 1);
+        if (rhs >= -EPSILON) continue;
+        double weight = p->rule == PRICING_STEEPEST_EDGE ? tableau_inverse_row_norm(t, i) : p->row_weights[i];
+        double score = rhs * rhs / weight;
+        if (score > best) {
+            best = score;
+            pivot_row = i;
+        }
+    }
+    return pivot_row;
+}
+
+/* Devex reference weight updates for a pivot on (r, q); call before the pivot. */
+static void update_tableau_devex(Tableau* t, Pricing* p, int r, int q) {
+    if (p->rule != PRICING_DEVEX) return;
+    double* prow = tableau_row(t, r);
+    double alpha = prow[q];
+    double column_weight = p->column_weights[q];
+    double row_weight = p->row_weights[r];
+    
+    for (int j = 0; j < t->cols - 1; j++) {
+        double ratio = prow[j] / alpha;
+        if (ratio != 0.0) p->column_weights[j] = fmax(p->column_weights[j], ratio * ratio * column_weight);
+    }
+    p->column_weights[t->basis[r]] = fmax(column_weight / (alpha * alpha), 1.0);
+    
+    for (int i = 0; i < t->rows - 1; i++) {
+        double ratio = TABLEAU_AT(t, i, q) / alpha;
+        if (ratio != 0.0) p->row_weights[i] = fmax(p->row_weights[i], ratio * ratio * row_weight);
+    }
+    p->row_weights[r] = fmax(row_weight / (alpha * alpha), 1.0);
+}
+
+/*
+ * Row elimination kernels: row[j] -= factor * prow[j]. The widest variant the
+ * CPU supports is picked once at runtime, unless a tableau pins its own;
+ * every tableau row is 64-byte aligned and zero-padded, so callers may pass
+ * the padded width.
+ */
+
+static void eliminate_row_scalar(double* restrict row, const double* restrict prow, double factor, int cols) {
+    for (int j = 0; j < cols; j++) {
+        row[j] -= factor * prow[j];
+    }
+}
+
+#if SIMPLEX_X86
+__attribute__((target("sse2")))
+static void eliminate_row_sse2(double* restrict row, const double* restrict prow, double factor, int cols) {
+    __m128d f = _mm_set1_pd(factor);
+    int j = 0;
+    for (; j + 2 <= cols; j += 2) {
+        __m128d r = _mm_loadu_pd(row + j);
+        _mm_storeu_pd(row + j, _mm_sub_pd(r, _mm_mul_pd(f, _mm_loadu_pd(prow + j))));
+    }
+    for (; j < cols; j++) {
+        row[j] -= factor * prow[j];
+    }
+}
+
+__attribute__((target("avx2,fma")))
+static void eliminate_row_avx2(double* restrict row, const double* restrict prow, double factor, int cols) {
+    __m256d f = _mm256_set1_pd(factor);
+    int j = 0;
+    for (; j + 8 <= cols; j += 8) {
+        __m256d r0 = _mm256_fnmadd_pd(f, _mm256_loadu_pd(prow + j), _mm256_loadu_pd(row + j));
+        __m256d r1 = _mm256_fnmadd_pd(f, _mm256_loadu_pd(prow + j + 4), _mm256_loadu_pd(row + j + 4));
+        _mm256_storeu_pd(row + j, r0);
+        _mm256_storeu_pd(row + j + 4, r1);
+    }
+    for (; j < cols; j++) {
+        row[j] = fma(-factor, prow[j], row[j]);
+    }
+}
+
+__attribute__((target("avx512f")))
+static void eliminate_row_avx512(double* restrict row, const double* restrict prow, double factor, int cols) {
+    __m512d f = _mm512_set1_pd(factor);
+    int j = 0;
+    for (; j + 8 <= cols; j += 8) {
+        __m512d r = _mm512_fnmadd_pd(f, _mm512_loadu_pd(prow + j), _mm512_loadu_pd(row + j));
+        _mm512_storeu_pd(row + j, r);
+    }
+    if (j < cols) {
+        __mmask8 tail = (__mmask8)((1u << (cols - j)) - 1);
+        __m512d r = _mm512_fnmadd_pd(f, _mm512_maskz_loadu_pd(tail, prow + j), _mm512_maskz_loadu_pd(tail, row + j));
+        _mm512_mask_storeu_pd(row + j, tail, r);
+    }
+}
+#endif
+
+static const char* kernel_names[NUM_KERNELS] = { "scalar", "sse2", "avx2+fma", "avx512" };
+static const EliminateKernel eliminate_kernels[NUM_KERNELS] = {
+    eliminate_row_scalar,
+#if SIMPLEX_X86
+    eliminate_row_sse2, eliminate_row_avx2, eliminate_row_avx512
+#endif
+};
+
+int kernel_supported(KernelLevel level) {
+#if SIMPLEX_X86
+    __builtin_cpu_init();
+    switch (level) {
+        case KERNEL_SCALAR: return 1;
+        case KERNEL_SSE2: return __builtin_cpu_supports("sse2");
+        case KERNEL_AVX2: return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        case KERNEL_AVX512: return __builtin_cpu_supports("avx512f");
+        default: return 0;
+    }
+#else
+    return level == KERNEL_SCALAR;
+#endif
+}
+
+KernelLevel best_kernel_level(void) {
+    KernelLevel level = KERNEL_AVX512;
+    while (level > KERNEL_SCALAR && !kernel_supported(level)) level--;
+    return level;
+}
+
+/* Pins t's pivots to one kernel (e.g. for benchmarking); returns 0 if the CPU lacks it. */
+int set_tableau_kernel(Tableau* t, KernelLevel level) {
+    if (!kernel_supported(level)) return 0;
+    t->eliminate = eliminate_kernels[level];
+    return 1;
+}
+
+static pthread_once_t kernel_once = PTHREAD_ONCE_INIT;
+static EliminateKernel best_kernel;
+
+static void init_kernel(void) {
+    best_kernel = eliminate_kernels[best_kernel_level()];
+}
+
+static EliminateKernel tableau_kernel(const Tableau* t) {
+    if (t->eliminate) return t->eliminate;
+    pthread_once(&kernel_once, init_kernel);
+    return best_kernel;
+}
+
+
+void pivot_operation(Tableau* t, int pivot_row, int pivot_col) {
+    int cols = t->cols;
+    int width = (int)round_up((size_t)cols, TABLEAU_ALIGNMENT / sizeof(double));
+    double* prow = tableau_row(t, pivot_row);
+    double pivot_element = prow[pivot_col];
+    EliminateKernel eliminate_row = tableau_kernel(t);
+    
+    for (int j = 0; j < cols; j++) {
+        prow[j] /= pivot_element;
+    }
+    
+    for (int i = 0; i < t->rows; i++) {
+        if (i == pivot_row) continue;
+        double* row = tableau_row(t, i);
+        double factor = row[pivot_col];
+        if (factor != 0.0) {
+            eliminate_row(row, prow, factor, width);
+        }
+    }
+    
+    t->basis[pivot_row] = pivot_col;
+}
+
+/*
+ * Optional thread pool for wide tableaus. Once the pivot row is normalized
+ * every other row update is independent, so each pivot is split into
+ * cache-line aligned column blocks, one per thread, with the calling thread
+ * taking the first block. Row factors are snapshotted up front because the
+ * block owning the pivot column overwrites them.
+ */
+#define PARALLEL_PIVOT_MIN_CELLS (1 << 17)
+
+struct PivotPool {
+    pthread_t* threads;
+    int num_threads;
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    unsigned long generation;
+    int pending;
+    int shutdown;
+    Tableau* t;
+    int pivot_row;
+    int width;
+    double* factors;
+    int factor_capacity;
+};
+
+typedef struct {
+    PivotPool* pool;
+    int index;
+} PivotWorker;
+
+static void eliminate_block(PivotPool* pool, int index) {
+    int line = TABLEAU_ALIGNMENT / sizeof(double);
+    int lines = (pool->width + line - 1) / line;
+    int first = (int)((long)lines * index / pool->num_threads) * line;
+    int last = (int)((long)lines * (index + 1) / pool->num_threads) * line;
+    if (last > pool->width) last = pool->width;
+    if (first >= last) return;
+    
+    Tableau* t = pool->t;
+    const double* prow = tableau_row(t, pool->pivot_row);
+    EliminateKernel eliminate_row = tableau_kernel(t);
+    for (int i = 0; i < t->rows; i++) {
+        if (i == pool->pivot_row || pool->factors[i] == 0.0) continue;
+        eliminate_row(tableau_row(t, i) + first, prow + first, pool->factors[i], last - first);
+    }
+}
+
+static void* pivot_worker_main(void* arg) {
+    PivotWorker* worker = (PivotWorker*)arg;
+    PivotPool* pool = worker->pool;
+    unsigned long seen = 0;
+    
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->generation == seen && !pool->shutdown) {
+            pthread_cond_wait(&pool->start, &pool->lock);
+        }
+        seen = pool->generation;
+        int shutdown = pool->shutdown;
+        pthread_mutex_unlock(&pool->lock);
+        if (shutdown) break;
+        
+        eliminate_block(pool, worker->index);
+        
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->pending == 0) pthread_cond_signal(&pool->done);
+        pthread_mutex_unlock(&pool->lock);
+    }
+    free(worker);
+    return NULL;
+}
+
+/* Stops and joins the first `started` workers, then frees the pool. */
+static void destroy_pivot_pool(PivotPool* pool, int started) {
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+    for (int k = 0; k < started; k++) {
+        pthread_join(pool->threads[k], NULL);
+    }
+    
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->start);
+    pthread_cond_destroy(&pool->done);
+    free(pool->threads);
+    free(pool->factors);
+    free(pool);
+}
+
+/* NULL below two threads or if any thread cannot be started; callers then pivot serially. */
+PivotPool* create_pivot_pool(int num_threads) {
+    if (num_threads < 2) return NULL;
+    
+    PivotPool* pool = (PivotPool*)calloc(1, sizeof(PivotPool));
+    if (!pool) return NULL;
+    pool->num_threads = num_threads;
+    pool->threads = (pthread_t*)malloc((num_threads - 1) * sizeof(pthread_t));
+    if (!pool->threads) {
+        free(pool);
+        return NULL;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    
+    for (int k = 1; k < num_threads; k++) {
+        PivotWorker* worker = (PivotWorker*)malloc(sizeof(PivotWorker));
+        if (worker) {
+            worker->pool = pool;
+            worker->index = k;
+        }
+        if (!worker || pthread_create(&pool->threads[k - 1], NULL, pivot_worker_main, worker) != 0) {
+            free(worker);
+            destroy_pivot_pool(pool, k - 1);
+            return NULL;
+        }
+    }
+    return pool;
+}
+
+void free_pivot_pool(PivotPool* pool) {
+    if (pool) destroy_pivot_pool(pool, pool->num_threads - 1);
+}
+
+/* Room for one factor per row; 0 if it cannot be had. */
+static int reserve_pivot_factors(PivotPool* pool, int rows) {
+    if (pool->factor_capacity >= rows) return 1;
+    free(pool->factors);
+    pool->factors = (double*)malloc(rows * sizeof(double));
+    pool->factor_capacity = pool->factors ? rows : 0;
+    return pool->factors != NULL;
+}
+
+/* Same result as pivot_operation; falls back to it without a pool, below the size threshold or out of memory. */
+void parallel_pivot_operation(PivotPool* pool, Tableau* t, int pivot_row, int pivot_col) {
+    if (!pool || (long)t->rows * t->cols < PARALLEL_PIVOT_MIN_CELLS || !reserve_pivot_factors(pool, t->rows)) {
+        pivot_operation(t, pivot_row, pivot_col);
+        return;
+    }
+    
+    double* prow = tableau_row(t, pivot_row);
+    double pivot_element = prow[pivot_col];
+    for (int j = 0; j < t->cols; j++) {
+        prow[j] /= pivot_element;
+    }
+    
+    for (int i = 0; i < t->rows; i++) {
+        pool->factors[i] = TABLEAU_AT(t, i, pivot_col);
+    }
+    
+    pthread_mutex_lock(&pool->lock);
+    pool->t = t;
+    pool->pivot_row = pivot_row;
+    pool->width = (int)round_up((size_t)t->cols, TABLEAU_ALIGNMENT / sizeof(double));
+    pool->pending = pool->num_threads - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+    
+    eliminate_block(pool, 0);
+    
+    pthread_mutex_lock(&pool->lock);
+    while (pool->pending > 0) {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    
+    t->basis[pivot_row] = pivot_col;
+}
+
+/* Iteration and wall-clock limits for one solve; deadline_ns = 0 means none. */
+typedef struct {
+    int max_iterations;
+    long long deadline_ns;
+} SolveBudget;
+
+/* Enough for every solve that is not cycling; the time budget is the real latency control. */
+static int default_iteration_limit(int num_foods, int num_nutrients) {
+    return 100 + 10 * (num_foods + num_nutrients);
+}
+
+static SolveBudget make_budget(const SolverOptions* opts, int num_foods, int num_nutrients) {
+    SolveBudget budget;
+    budget.max_iterations = opts->max_iterations > 0 ? opts->max_iterations
+                                                     : default_iteration_limit(num_foods, num_nutrients);
+    budget.deadline_ns = opts->time_limit_ns > 0 ? monotonic_ns() + opts->time_limit_ns : 0;
+    return budget;
+}
+
+/* SOLVE_OPTIMAL (0) while another pivot is allowed, otherwise the limit that was hit. */
+static SolveStatus budget_check(const SolveBudget* budget, int iteration) {
+    if (iteration >= budget->max_iterations) return SOLVE_ITERATION_LIMIT;
+    if (budget->deadline_ns && monotonic_ns() >= budget->deadline_ns) return SOLVE_TIME_LIMIT;
+    return SOLVE_OPTIMAL;
+}
+
+const char* solve_status_name(SolveStatus status) {
+    static const char* names[] = {
+        "optimal", "infeasible", "unbounded", "iteration limit", "time limit", "numerical error"
+    };
+    return names[status];
+}
+
+/*
+ * Tracing. The engines hand each event to opts->trace as it happens and
+ * build nothing unless one is installed, so an untraced solve pays a null
+ * check per pivot. verbose installs print_trace_event, one line per event.
+ * TraceRing is a sink that keeps the latest events in a fixed binary buffer
+ * for reading after the solve: records are length prefixed, the oldest are
+ * overwritten when it fills, and a record too large for the whole buffer
+ * loses its deltas. A ring is fed by one solve at a time.
+ */
+static void print_trace_event(const PivotEvent* e, void* user) {
+    (void)user;
+    static const char* phases[] = { "dual", "phase 1", "phase 2" };
+    switch (e->kind) {
+    case TRACE_START:
+        printf("\nStarting %s\n", e->phase ? phases[e->phase] : "the dual simplex");
+        break;
+    case TRACE_PIVOT:
+        printf("Iteration %d (%s): column %d enters, row %d leaves (pivot %.6f, objective %.6f)\n",
+               e->iteration, phases[e->phase], e->col, e->row, e->pivot, e->objective);
+        break;
+    case TRACE_PERTURB:
+        printf("Perturbing after %d iterations\n", e->iteration);
+        break;
+    case TRACE_UNPERTURB:
+        printf("Removing the perturbation after %d iterations\n", e->iteration);
+        break;
+    case TRACE_PHASE_ONE_DONE:
+        printf("Phase 1 complete after %d iterations\n", e->iteration);
+        break;
+    case TRACE_END:
+        printf("Finished after %d iterations: %s, objective %.6f\n",
+               e->iteration, solve_status_name((SolveStatus)e->status), e->objective);
+        break;
+    }
+}
+
+static const PivotTrace print_trace = { print_trace_event, NULL, 0 };
+
+static const PivotTrace* solve_trace(const SolverOptions* opts) {
+    if (opts->trace) return opts->trace;
+    return opts->verbose ? &print_trace : NULL;
+}
+
+static void trace_note(const PivotTrace* trace, TraceEventKind kind, int iteration, int phase, int status,
+                       double objective) {
+    if (!trace) return;
+    PivotEvent e = { kind, iteration, phase, -1, -1, 0.0, objective, status, 0, 0, NULL, NULL };
+    trace->fn(&e, trace->user);
+}
+
+typedef struct {
+    int bytes;              /* the whole record, deltas included */
+    int kind;
+    int iteration;
+    int phase;
+    int row;
+    int col;
+    int status;
+    int num_rows;
+    int num_cols;
+    double pivot;
+    double objective;
+} TraceRecord;
+
+typedef struct {
+    unsigned char* data;
+    size_t capacity;
+    size_t start;
+    size_t used;
+    long long dropped;      /* records overwritten or too large to keep */
+} TraceRing;
+
+TraceRing* create_trace_ring(size_t capacity) {
+    TraceRing* ring = (TraceRing*)calloc(1, sizeof(TraceRing));
+    if (!ring) return NULL;
+    ring->data = (unsigned char*)malloc(capacity);
+    if (!ring->data) {
+        free(ring);
+        return NULL;
+    }
+    ring->capacity = capacity;
+    return ring;
+}
+
+void free_trace_ring(TraceRing* ring) {
+    if (!ring) return;
+    free(ring->data);
+    free(ring);
+}
+
+static void ring_write(TraceRing* ring, size_t at, const void* src, size_t bytes) {
+    if (!bytes) return;
+    at %= ring->capacity;
+    size_t first = bytes < ring->capacity - at ? bytes : ring->capacity - at;
+    memcpy(ring->data + at, src, first);
+    memcpy(ring->data, (const unsigned char*)src + first, bytes - first);
+}
+
+static void ring_read(const TraceRing* ring, size_t at, void* dst, size_t bytes) {
+    at %= ring->capacity;
+    size_t first = bytes < ring->capacity - at ? bytes : ring->capacity - at;
+    memcpy(dst, ring->data + at, first);
+    memcpy((unsigned char*)dst + first, ring->data, bytes - first);
+}
+
+static void ring_pop(TraceRing* ring) {
+    int bytes;
+    ring_read(ring, ring->start, &bytes, sizeof(int));
+    ring->start = (ring->start + bytes) % ring->capacity;
+    ring->used -= bytes;
+}
+
+/* A PivotTraceFn; user is the TraceRing. */
+void trace_ring_sink(const PivotEvent* e, void* user) {
+    TraceRing* ring = (TraceRing*)user;
+    size_t rows = e->column ? e->num_rows : 0;
+    size_t cols = e->pivot_row ? e->num_cols : 0;
+    size_t bytes = sizeof(TraceRecord) + (rows + cols) * sizeof(double);
+    if (bytes > ring->capacity) {
+        rows = cols = 0;
+        bytes = sizeof(TraceRecord);
+    }
+    if (bytes > ring->capacity) {
+        ring->dropped++;
+        return;
+    }
+    while (ring->capacity - ring->used < bytes) {
+        ring_pop(ring);
+        ring->dropped++;
+    }
+    
+    TraceRecord rec = { (int)bytes, e->kind, e->iteration, e->phase, e->row, e->col, e->status,
+                        rows ? e->num_rows : 0, cols ? e->num_cols : 0, e->pivot, e->objective };
+    size_t at = ring->start + ring->used;
+    ring_write(ring, at, &rec, sizeof(rec));
+    at += sizeof(rec);
+    ring_write(ring, at, e->column, rows * sizeof(double));
+    at += rows * sizeof(double);
+    ring_write(ring, at, e->pivot_row, cols * sizeof(double));
+    ring->used += bytes;
+}
+
+/*
+ * Takes the oldest event off the ring: returns 0 when it is empty. The
+ * deltas are copied to `deltas` and event->column and event->pivot_row
+ * point into it; they are NULL (and num_rows, num_cols 0) when the record
+ * kept none or they need more than max_deltas doubles.
+ */
+int trace_ring_next(TraceRing* ring, PivotEvent* event, double* deltas, int max_deltas) {
+    if (!ring->used) return 0;
+    TraceRecord rec;
+    ring_read(ring, ring->start, &rec, sizeof(rec));
+    PivotEvent e = { (TraceEventKind)rec.kind, rec.iteration, rec.phase, rec.row, rec.col, rec.pivot,
+                     rec.objective, rec.status, rec.num_rows, rec.num_cols, NULL, NULL };
+    int count = rec.num_rows + rec.num_cols;
+    if (count && count <= max_deltas) {
+        ring_read(ring, ring->start + sizeof(rec), deltas, count * sizeof(double));
+        if (rec.num_rows) e.column = deltas;
+        if (rec.num_cols) e.pivot_row = deltas + rec.num_rows;
+    } else {
+        e.num_rows = e.num_cols = 0;
+    }
+    ring_pop(ring);
+    *event = e;
+    return 1;
+}
+
+/*
+ * Degeneracy. A pivot is degenerate when its step is zero: the leaving value
+ * (primal) or the entering reduced cost (dual) is within EPSILON of zero, so
+ * the objective does not move. Diet problems produce many of these because
+ * several requirements usually bind at once. After STALL_PERTURB_PIVOTS of
+ * them in a row the engines perturb the problem by small random amounts, the
+ * basic values under the primal simplex and the nonbasic costs under the
+ * dual, which breaks the ties; the perturbation is removed once the
+ * perturbed problem is optimal and the few pivots that restores are made on
+ * the original data. A stall that lasts STALL_BLAND_PIVOTS switches to
+ * Bland's rule, smallest index entering and leaving, which cannot cycle,
+ * until a pivot makes progress again.
+ */
+#define STALL_PERTURB_PIVOTS 10
+#define STALL_BLAND_PIVOTS 50
+#define PERTURBATION_SCALE 1e-5
+#define PERTURBATION_SEED 0x9e3779b97f4a7c15ULL
+
+typedef struct {
+    DegeneracyRule rule;
+    int stall;          /* degenerate pivots since the last one that made progress */
+    int degenerate;
+    unsigned long long seed;
+} Degeneracy;
+
+static void reset_degeneracy(Degeneracy* d, DegeneracyRule rule) {
+    d->rule = rule;
+    d->stall = 0;
+    d->degenerate = 0;
+    d->seed = PERTURBATION_SEED;
+}
+
+/* Records a pivot whose step (leaving value or entering reduced cost) was `step`. */
+static void record_pivot(Degeneracy* d, double step) {
+    if (step > EPSILON) {
+        d->stall = 0;
+        return;
+    }
+    d->stall++;
+    d->degenerate++;
+}
+
+static int should_perturb(const Degeneracy* d) {
+    return d->rule == DEGENERACY_PERTURB && d->stall >= STALL_PERTURB_PIVOTS;
+}
+
+static int use_bland(const Degeneracy* d) {
+    return d->rule != DEGENERACY_NONE && d->stall >= STALL_BLAND_PIVOTS;
+}
+
+/* A positive shift in [0.5, 1) * PERTURBATION_SCALE, relative to the value it is added to. */
+static double perturbation(Degeneracy* d, double value) {
+    return PERTURBATION_SCALE * (1.0 + fabs(value)) * (0.5 + 0.5 * uniform_random(&d->seed));
+}
+
+/* Bland's entering column: the first one with a negative reduced cost. */
+static int bland_pivot_column(const double* d, int count) {
+    for (int j = 0; j < count; j++) {
+        if (d[j] < -EPSILON) return j;
+    }
+    return -1;
+}
+
+/* Bland's leaving row: the minimum ratio, ties going to the smallest basic index. */
+static int bland_ratio_test(const double* x, const double* alpha, size_t stride, int count, const int* basis) {
+    int pivot_row = -1;
+    double min_ratio = INFINITY;
+    for (int i = 0; i < count; i++) {
+        double a = alpha[i * stride];
+        if (a > EPSILON) {
+            double ratio = fmax(0.0, x[i * stride]) / a;
+            if (ratio < min_ratio || (ratio == min_ratio && basis[i] < basis[pivot_row])) {
+                min_ratio = ratio;
+                pivot_row = i;
+            }
+        }
+    }
+    return pivot_row;
+}
+
+/* Bland's entering column for the dual: the minimum ratio, ties going to the smallest index. */
+static int bland_dual_ratio_test(const double* d, const double* alpha, int count) {
+    int pivot_col = -1;
+    double min_ratio = INFINITY;
+    for (int j = 0; j < count; j++) {
+        if (alpha[j] < -EPSILON) {
+            double ratio = fmax(0.0, d[j]) / -alpha[j];
+            if (ratio < min_ratio) {
+                min_ratio = ratio;
+                pivot_col = j;
+            }
+        }
+    }
+    return pivot_col;
+}
+
+/* Bland's leaving row for the dual: the infeasible row whose basic variable has the smallest index. */
+static int bland_dual_pivot_row(const double* x, size_t stride, int count, const int* basis) {
+    int pivot_row = -1;
+    for (int i = 0; i < count; i++) {
+        if (x[i * stride] < -EPSILON && (pivot_row == -1 || basis[i] < basis[pivot_row])) {
+            pivot_row = i;
+        }
+    }
+    return pivot_row;
+}
+
+/*
+ * Revised simplex engine. Only the m x m basis is kept, as a dense LU
+ * factorization plus a product-form eta file that is folded back in by a
+ * refactorization every REFACTOR_INTERVAL pivots. Columns are priced on
+ * demand from the food data, so the (m+1) x (n+m+1) tableau is never built.
+ *
+ * Columns are numbered [0, n) foods, [n, n+m) surplus (-e_i) and
+ * [n+m, n+2m) phase-1 artificials (+e_i).
+ */
+#define REFACTOR_INTERVAL 32
+
+typedef struct {
+    int m;
+    double* lu;
+    int* perm;
+    double* etas;
+    int* eta_rows;
+    int num_etas;
+} BasisFactor;
+
+static BasisFactor* arena_basis_factor(Arena* a, int m) {
+    BasisFactor* f = (BasisFactor*)arena_alloc(a, sizeof(BasisFactor));
+    if (!f) return NULL;
+    f->m = m;
+    f->lu = (double*)arena_alloc(a, (size_t)m * m * sizeof(double));
+    f->perm = (int*)arena_alloc(a, m * sizeof(int));
+    f->etas = (double*)arena_alloc(a, (size_t)REFACTOR_INTERVAL * m * sizeof(double));
+    f->eta_rows = (int*)arena_alloc(a, REFACTOR_INTERVAL * sizeof(int));
+    f->num_etas = 0;
+    return f->lu && f->perm && f->etas && f->eta_rows ? f : NULL;
+}
+
+/* Factor P*B = L*U in place with partial pivoting; `lu` holds B row-major on entry. */
+static int basis_factorize(BasisFactor* f) {
+    int m = f->m;
+    double* a = f->lu;
+    
+    for (int i = 0; i < m; i++) f->perm[i] = i;
+    f->num_etas = 0;
+    
+    for (int k = 0; k < m; k++) {
+        int p = k;
+        for (int i = k + 1; i < m; i++) {
+            if (fabs(a[(size_t)i * m + k]) > fabs(a[(size_t)p * m + k])) p = i;
+        }
+        if (fabs(a[(size_t)p * m + k]) < EPSILON) return 0;
+        
+        if (p != k) {
+            for (int j = 0; j < m; j++) {
+                double tmp = a[(size_t)k * m + j];
+                a[(size_t)k * m + j] = a[(size_t)p * m + j];
+                a[(size_t)p * m + j] = tmp;
+            }
+            int tmp = f->perm[k];
+            f->perm[k] = f->perm[p];
+            f->perm[p] = tmp;
+        }
+        
+        double* urow = a + (size_t)k * m;
+        for (int i = k + 1; i < m; i++) {
+            double* row = a + (size_t)i * m;
+            double l = row[k] / urow[k];
+            row[k] = l;
+            if (l != 0.0) {
+                for (int j = k + 1; j < m; j++) {
+                    row[j] -= l * urow[j];
+                }
+            }
+        }
+    }
+    return 1;
+}
+
+/* Solve B x = rhs in place, `work` holds m scratch entries. */
+static void basis_ftran(const BasisFactor* f, double* x, double* work) {
+    int m = f->m;
+    const double* a = f->lu;
+    
+    for (int i = 0; i < m; i++) {
+        double v = x[f->perm[i]];
+        for (int k = 0; k < i; k++) {
+            v -= a[(size_t)i * m + k] * work[k];
+        }
+        work[i] = v;
+    }
+    for (int i = m - 1; i >= 0; i--) {
+        double v = work[i];
+        for (int k = i + 1; k < m; k++) {
+            v -= a[(size_t)i * m + k] * x[k];
+        }
+        x[i] = v / a[(size_t)i * m + i];
+    }
+    
+    for (int e = 0; e < f->num_etas; e++) {
+        const double* d = f->etas + (size_t)e * m;
+        int r = f->eta_rows[e];
+        double pivot = x[r] / d[r];
+        for (int i = 0; i < m; i++) {
+            x[i] -= d[i] * pivot;
+        }
+        x[r] = pivot;
+    }
+}
+
+/* Solve B^T y = rhs in place, `work` holds m scratch entries. */
+static void basis_btran(const BasisFactor* f, double* y, double* work) {
+    int m = f->m;
+    const double* a = f->lu;
+    
+    for (int e = f->num_etas - 1; e >= 0; e--) {
+        const double* d = f->etas + (size_t)e * m;
+        int r = f->eta_rows[e];
+        double v = y[r];
+        for (int i = 0; i < m; i++) {
+            if (i != r) v -= d[i] * y[i];
+        }
+        y[r] = v / d[r];
+    }
+    
+    for (int i = 0; i < m; i++) {
+        double v = y[i];
+        for (int k = 0; k < i; k++) {
+            v -= a[(size_t)k * m + i] * work[k];
+        }
+        work[i] = v / a[(size_t)i * m + i];
+    }
+    for (int i = m - 1; i >= 0; i--) {
+        double v = work[i];
+        for (int k = i + 1; k < m; k++) {
+            v -= a[(size_t)k * m + i] * work[k];
+        }
+        work[i] = v;
+    }
+    for (int i = 0; i < m; i++) {
+        y[f->perm[i]] = work[i];
+    }
+}
+
+static void basis_add_eta(BasisFactor* f, int r, const double* d) {
+    memcpy(f->etas + (size_t)f->num_etas * f->m, d, f->m * sizeof(double));
+    f->eta_rows[f->num_etas++] = r;
+}
+
+typedef struct {
+    const DietProblem* problem;
+    const double* requirements;
+    int n;
+    int m;
+    int* basis;
+    double* x_basic;
+    BasisFactor* factor;
+    double* y;
+    double* rho;
+    double* column;
+    double* work;
+    double* tau;
+    double* row_alpha;
+    double* row_cost;
+    Pricing* pricing;
+    SolveStats* stats;
+    const PivotTrace* trace;
+    double* trace_column;   /* column as the pivot saw it, when the trace wants deltas */
+} RevisedLP;
+
+static void revised_column(const RevisedLP* lp, int col, double* out) {
+    const DietProblem* p = lp->problem;
+    if (col < lp->n && p->nutrients) {
+        memcpy(out, food_column(p, col), lp->m * sizeof(double));
+        return;
+    }
+    memset(out, 0, lp->m * sizeof(double));
+    if (col < lp->n) {
+        for (int k = p->col_start[col]; k < p->col_start[col + 1]; k++) {
+            out[p->row_index[k]] = p->values[k];
+        }
+    } else if (col < lp->n + lp->m) {
+        out[col - lp->n] = -1.0;
+    } else {
+        out[col - lp->n - lp->m] = 1.0;
+    }
+}
+
+static double revised_cost(const RevisedLP* lp, int col, int phase) {
+    if (phase == 1) return col >= lp->n + lp->m ? 1.0 : 0.0;
+    return col < lp->n ? lp->problem->costs[col] : 0.0;
+}
+
+static double revised_objective(const RevisedLP* lp) {
+    double z = 0.0;
+    for (int i = 0; i < lp->m; i++) {
+        z += revised_cost(lp, lp->basis[i], 2) * lp->x_basic[i];
+    }
+    return z;
+}
+
+/* Reports the pivot just made on row r; `pivot` is the element it divided by. */
+static void revised_trace_pivot(const RevisedLP* lp, int iteration, int phase, int r, int q, double pivot) {
+    PivotEvent e = { TRACE_PIVOT, iteration, phase, r, q, pivot, revised_objective(lp), SOLVE_OPTIMAL,
+                     lp->trace_column ? lp->m : 0, 0, lp->trace_column, NULL };
+    lp->trace->fn(&e, lp->trace->user);
+}
+
+static int revised_refactor(RevisedLP* lp) {
+    int m = lp->m;
+    for (int j = 0; j < m; j++) {
+        revised_column(lp, lp->basis[j], lp->column);
+        for (int i = 0; i < m; i++) {
+            lp->factor->lu[(size_t)i * m + j] = lp->column[i];
+        }
+    }
+    if (!basis_factorize(lp->factor)) return 0;
+    
+    memcpy(lp->x_basic, lp->requirements, m * sizeof(double));
+    basis_ftran(lp->factor, lp->x_basic, lp->work);
+    return 1;
+}
+
+static void revised_duals(RevisedLP* lp, int phase) {
+    for (int i = 0; i < lp->m; i++) {
+        lp->y[i] = revised_cost(lp, lp->basis[i], phase);
+    }
+    basis_btran(lp->factor, lp->y, lp->work);
+}
+
+/* v . a_col without materializing the column. */
+static double revised_dot(const RevisedLP* lp, int col, const double* v) {
+    const DietProblem* p = lp->problem;
+    double dot = 0.0;
+    if (col < lp->n && p->nutrients) {
+        const double* a = food_column(p, col);
+        for (int i = 0; i < lp->m; i++) dot += v[i] * a[i];
+    } else if (col < lp->n) {
+        for (int k = p->col_start[col]; k < p->col_start[col + 1]; k++) {
+            dot += v[p->row_index[k]] * p->values[k];
+        }
+    } else if (col < lp->n + lp->m) {
+        dot = -v[col - lp->n];
+    } else {
+        dot = v[col - lp->n - lp->m];
+    }
+    return dot;
+}
+
+static double revised_reduced_cost(const RevisedLP* lp, int col, int phase) {
+    return revised_cost(lp, col, phase) - revised_dot(lp, col, lp->y);
+}
+
+static int revised_pivot(RevisedLP* lp, int r, int q) {
+    double theta = lp->x_basic[r] / lp->column[r];
+    for (int i = 0; i < lp->m; i++) {
+        lp->x_basic[i] -= theta * lp->column[i];
+    }
+    lp->x_basic[r] = theta;
+    lp->basis[r] = q;
+    
+    if (lp->factor->num_etas == REFACTOR_INTERVAL) {
+        return revised_refactor(lp);
+    }
+    basis_add_eta(lp->factor, r, lp->column);
+    return 1;
+}
+
+/*
+ * Multiple pricing: reprice the surviving candidates and take the best; once
+ * none is attractive, scan segments from where the last scan stopped and
+ * keep the PRICING_CANDIDATES best columns of the first segment that has
+ * any. Optimality is only declared after a scan that wraps all the way round.
+ */
+static int revised_price_partial(RevisedLP* lp, const int* basis_pos, int priced_cols, int phase,
+                                 double* reduced_cost) {
+    Pricing* p = lp->pricing;
+    int q = -1;
+    double min_d = -EPSILON;
+    
+    int kept = 0;
+    for (int k = 0; k < p->num_candidates; k++) {
+        int j = p->candidates[k];
+        if (j >= priced_cols || basis_pos[j]) continue;
+        double d = revised_reduced_cost(lp, j, phase);
+        if (d >= -EPSILON) continue;
+        p->candidates[kept++] = j;
+        if (d < min_d) {
+            min_d = d;
+            q = j;
+        }
+    }
+    p->num_candidates = kept;
+    if (q != -1) {
+        *reduced_cost = min_d;
+        return q;
+    }
+    
+    int length = partial_segment_length(priced_cols);
+    int start = p->next_col < priced_cols ? p->next_col : 0;
+    double scores[PRICING_CANDIDATES];
+    for (int scanned = 0; scanned < priced_cols; scanned += length) {
+        int end = start + length < priced_cols ? start + length : priced_cols;
+        int count = 0;
+        for (int j = start; j < end; j++) {
+            if (basis_pos[j]) continue;
+            double d = revised_reduced_cost(lp, j, phase);
+            if (d >= -EPSILON || (count == PRICING_CANDIDATES && d >= scores[count - 1])) continue;
+            /* Insertion into the short list, kept sorted by reduced cost. */
+            int k = count < PRICING_CANDIDATES ? count++ : count - 1;
+            while (k > 0 && scores[k - 1] > d) {
+                scores[k] = scores[k - 1];
+                p->candidates[k] = p->candidates[k - 1];
+                k--;
+            }
+            scores[k] = d;
+            p->candidates[k] = j;
+        }
+        start = end < priced_cols ? end : 0;
+        if (count > 0) {
+            p->num_candidates = count;
+            p->next_col = start;
+            *reduced_cost = scores[0];
+            return p->candidates[0];
+        }
+    }
+    return -1;
+}
+
+/*
+ * Primal pricing; lp->y must hold the duals for `phase`. Returns the entering
+ * column and its reduced cost, or -1 when none is below -EPSILON.
+ */
+static int revised_price(RevisedLP* lp, const int* basis_pos, int phase, double* reduced_cost) {
+    Pricing* p = lp->pricing;
+    int priced_cols = phase == 1 ? lp->n + 2 * lp->m : lp->n + lp->m;
+    int q = -1;
+    
+    if (p->rule == PRICING_PARTIAL) return revised_price_partial(lp, basis_pos, priced_cols, phase, reduced_cost);
+    
+    double best = 0.0;
+    for (int j = 0; j < priced_cols; j++) {
+        if (basis_pos[j]) continue;
+        double d = revised_reduced_cost(lp, j, phase);
+        if (d >= -EPSILON) continue;
+        double score = p->rule == PRICING_DANTZIG ? -d : d * d / p->column_weights[j];
+        if (score > best) {
+            best = score;
+            q = j;
+            *reduced_cost = d;
+        }
+    }
+    return q;
+}
+
+/*
+ * Devex and steepest-edge weight updates for the primal pivot (r, q), made
+ * while lp->column still holds B^-1 a_q for the old basis. Steepest edge
+ * uses the Goldfarb-Reid recurrence, which also needs B^-T B^-1 a_q.
+ */
+static void revised_update_primal_weights(RevisedLP* lp, const int* basis_pos, int phase, int r, int q) {
+    Pricing* p = lp->pricing;
+    if (p->rule != PRICING_DEVEX && p->rule != PRICING_STEEPEST_EDGE) return;
+    int m = lp->m;
+    int priced_cols = phase == 1 ? lp->n + 2 * m : lp->n + m;
+    int steepest = p->rule == PRICING_STEEPEST_EDGE;
+    double alpha = lp->column[r];
+    double gamma = p->column_weights[q];
+    
+    memset(lp->rho, 0, m * sizeof(double));
+    lp->rho[r] = 1.0;
+    basis_btran(lp->factor, lp->rho, lp->work);
+    if (steepest) {
+        gamma = 1.0;
+        for (int i = 0; i < m; i++) {
+            gamma += lp->column[i] * lp->column[i];
+        }
+        memcpy(lp->tau, lp->column, m * sizeof(double));
+        basis_btran(lp->factor, lp->tau, lp->work);
+    }
+    
+    for (int j = 0; j < priced_cols; j++) {
+        if (basis_pos[j] || j == q) continue;
+        double alpha_j = revised_dot(lp, j, lp->rho);
+        if (alpha_j == 0.0) continue;
+        double ratio = alpha_j / alpha;
+        if (steepest) {
+            double w = p->column_weights[j] - 2.0 * ratio * revised_dot(lp, j, lp->tau) + ratio * ratio * gamma;
+            p->column_weights[j] = fmax(w, 1.0 + ratio * ratio);
+        } else {
+            p->column_weights[j] = fmax(p->column_weights[j], ratio * ratio * gamma);
+        }
+    }
+    p->column_weights[lp->basis[r]] = fmax(gamma / (alpha * alpha), 1.0);
+}
+
+/* Dual counterpart for row weights; lp->rho holds row r of B^-1 and lp->column B^-1 a_q. */
+static void revised_update_dual_weights(RevisedLP* lp, int r) {
+    Pricing* p = lp->pricing;
+    if (p->rule != PRICING_DEVEX && p->rule != PRICING_STEEPEST_EDGE) return;
+    int m = lp->m;
+    int steepest = p->rule == PRICING_STEEPEST_EDGE;
+    double alpha = lp->column[r];
+    double beta = p->row_weights[r];
+    
+    if (steepest) {
+        beta = 0.0;
+        for (int i = 0; i < m; i++) {
+            beta += lp->rho[i] * lp->rho[i];
+        }
+        memcpy(lp->tau, lp->rho, m * sizeof(double));
+        basis_ftran(lp->factor, lp->tau, lp->work);
+    }
+    
+    for (int i = 0; i < m; i++) {
+        if (i == r || lp->column[i] == 0.0) continue;
+        double ratio = lp->column[i] / alpha;
+        if (steepest) {
+            double w = p->row_weights[i] - 2.0 * ratio * lp->tau[i] + ratio * ratio * beta;
+            p->row_weights[i] = fmax(w, EPSILON);
+        } else {
+            p->row_weights[i] = fmax(p->row_weights[i], ratio * ratio * beta);
+        }
+    }
+    p->row_weights[r] = steepest ? beta / (alpha * alpha) : fmax(beta / (alpha * alpha), 1.0);
+}
+
+/* Exact steepest-edge weights for a freshly factored basis: row norms of B^-1, one BTRAN each. */
+static void revised_init_dual_weights(RevisedLP* lp) {
+    if (lp->pricing->rule != PRICING_STEEPEST_EDGE) return;
+    for (int i = 0; i < lp->m; i++) {
+        memset(lp->rho, 0, lp->m * sizeof(double));
+        lp->rho[i] = 1.0;
+        basis_btran(lp->factor, lp->rho, lp->work);
+        double norm = 0.0;
+        for (int k = 0; k < lp->m; k++) {
+            norm += lp->rho[k] * lp->rho[k];
+        }
+        lp->pricing->row_weights[i] = norm;
+    }
+}
+
+/* Pivot basic artificials left at zero after phase 1 out of the basis where possible. */
+static int revised_drive_out_artificials(RevisedLP* lp, int* basis_pos) {
+    int m = lp->m;
+    int first_artificial = lp->n + m;
+    
+    for (int r = 0; r < m; r++) {
+        if (lp->basis[r] < first_artificial) continue;
+        
+        memset(lp->rho, 0, m * sizeof(double));
+        lp->rho[r] = 1.0;
+        basis_btran(lp->factor, lp->rho, lp->work);
+        
+        int q = -1;
+        double best = EPSILON;
+        for (int j = 0; j < first_artificial; j++) {
+            if (basis_pos[j]) continue;
+            double alpha = revised_dot(lp, j, lp->rho);
+            if (fabs(alpha) > best) {
+                best = fabs(alpha);
+                q = j;
+            }
+        }
+        if (q == -1) continue;
+        
+        revised_column(lp, q, lp->column);
+        basis_ftran(lp->factor, lp->column, lp->work);
+        basis_pos[lp->basis[r]] = 0;
+        basis_pos[q] = r + 1;
+        if (!revised_pivot(lp, r, q)) return 0;
+    }
+    return 1;
+}
+
+/*
+ * Dual simplex from a dual feasible basis: the most negative basic variable
+ * leaves, and the dual ratio test over row r of B^-1 A picks the entering
+ * column that keeps every reduced cost nonnegative. Returns SOLVE_OPTIMAL once
+ * the basis is primal feasible, SOLVE_INFEASIBLE or a budget limit, or -1 on
+ * failure.
+ */
+static int revised_dual_simplex(RevisedLP* lp, int* basis_pos, int* iteration, const SolveBudget* budget,
+                                int harris, Degeneracy* degeneracy) {
+    int m = lp->m;
+    int priced_cols = lp->n + m;
+    int weighted = lp->pricing->rule == PRICING_DEVEX || lp->pricing->rule == PRICING_STEEPEST_EDGE;
+    long long factor_bytes = (long long)m * m * sizeof(double);
+    long long row_bytes = (long long)matrix_bytes(lp->problem) + 2LL * priced_cols * sizeof(double);
+    long long clock = STATS_CLOCK();
+    
+    for (;;) {
+        int bland = use_bland(degeneracy);
+        int r = bland ? bland_dual_pivot_row(lp->x_basic, 1, m, lp->basis) : -1;
+        double best = 0.0;
+        for (int i = 0; i < m && !bland; i++) {
+            double x = lp->x_basic[i];
+            if (x >= -EPSILON) continue;
+            double score = weighted ? x * x / lp->pricing->row_weights[i] : -x;
+            if (score > best) {
+                best = score;
+                r = i;
+            }
+        }
+        STATS_LAP(lp->stats, PHASE_PRICING, clock, m * (long long)sizeof(double));
+        if (r == -1) return SOLVE_OPTIMAL;
+        
+        SolveStatus limit = budget_check(budget, *iteration);
+        if (limit != SOLVE_OPTIMAL) return limit;
+        
+        revised_duals(lp, 2);
+        memset(lp->rho, 0, m * sizeof(double));
+        lp->rho[r] = 1.0;
+        basis_btran(lp->factor, lp->rho, lp->work);
+        
+        for (int j = 0; j < priced_cols; j++) {
+            lp->row_alpha[j] = 0.0;
+            if (basis_pos[j]) continue;
+            lp->row_alpha[j] = revised_dot(lp, j, lp->rho);
+            if (lp->row_alpha[j] < -EPSILON) lp->row_cost[j] = revised_reduced_cost(lp, j, 2);
+        }
+        int q;
+        if (bland) {
+            q = bland_dual_ratio_test(lp->row_cost, lp->row_alpha, priced_cols);
+        } else {
+            q = harris ? harris_dual_ratio_test(lp->row_cost, lp->row_alpha, priced_cols)
+                       : textbook_dual_ratio_test(lp->row_cost, lp->row_alpha, priced_cols);
+        }
+        STATS_LAP(lp->stats, PHASE_RATIO_TEST, clock, 2 * factor_bytes + row_bytes);
+        if (q == -1) return SOLVE_INFEASIBLE;
+        record_pivot(degeneracy, lp->row_cost[q]);
+        
+        revised_column(lp, q, lp->column);
+        basis_ftran(lp->factor, lp->column, lp->work);
+        revised_update_dual_weights(lp, r);
+        basis_pos[lp->basis[r]] = 0;
+        basis_pos[q] = r + 1;
+        double pivot = lp->column[r];
+        if (lp->trace_column) memcpy(lp->trace_column, lp->column, m * sizeof(double));
+        if (!revised_pivot(lp, r, q)) return -1;
+        STATS_LAP(lp->stats, PHASE_PIVOT, clock, 2 * factor_bytes);
+        (*iteration)++;
+        if (lp->trace) revised_trace_pivot(lp, *iteration, 0, r, q, pivot);
+    }
+}
+
+/* Bland's entering column: the first with a negative reduced cost; lp->y must hold the duals for `phase`. */
+static int revised_price_bland(RevisedLP* lp, const int* basis_pos, int phase, double* reduced_cost) {
+    int priced_cols = phase == 1 ? lp->n + 2 * lp->m : lp->n + lp->m;
+    for (int j = 0; j < priced_cols; j++) {
+        if (basis_pos[j]) continue;
+        double d = revised_reduced_cost(lp, j, phase);
+        if (d < -EPSILON) {
+            *reduced_cost = d;
+            return j;
+        }
+    }
+    return -1;
+}
+
+/*
+ * Shifts every basic value up by delta and the requirements by B delta to
+ * match, so that refactorizations, which recompute x_B from b, keep the shift.
+ */
+static void revised_perturb(RevisedLP* lp, double* perturbed_rhs, Degeneracy* d) {
+    int m = lp->m;
+    memcpy(perturbed_rhs, lp->requirements, m * sizeof(double));
+    for (int i = 0; i < m; i++) {
+        double delta = perturbation(d, lp->x_basic[i]);
+        lp->x_basic[i] += delta;
+        revised_column(lp, lp->basis[i], lp->column);
+        for (int k = 0; k < m; k++) {
+            perturbed_rhs[k] += delta * lp->column[k];
+        }
+    }
+    lp->requirements = perturbed_rhs;
+}
+
+static void revised_restore_requirements(RevisedLP* lp, const double* requirements) {
+    lp->requirements = requirements;
+    memcpy(lp->x_basic, requirements, lp->m * sizeof(double));
+    basis_ftran(lp->factor, lp->x_basic, lp->work);
+}
+
+/* Installs a caller-supplied basis; returns 0 if it is malformed or singular. */
+static int revised_load_basis(RevisedLP* lp, const int* basis, int* basis_pos) {
+    for (int i = 0; i < lp->m; i++) {
+        int col = basis[i];
+        if (col < 0 || col >= lp->n + lp->m || basis_pos[col]) return 0;
+        basis_pos[col] = i + 1;
+        lp->basis[i] = col;
+    }
+    return revised_refactor(lp);
+}
+
+static int revised_dual_feasible(RevisedLP* lp, const int* basis_pos) {
+    revised_duals(lp, 2);
+    for (int j = 0; j < lp->n + lp->m; j++) {
+        if (!basis_pos[j] && revised_reduced_cost(lp, j, 2) < -EPSILON) return 0;
+    }
+    return 1;
+}
+
+/*
+ * Scratch for a solve: the arena, the engine arrays carved from it by
+ * prepare_workspace for the problem at hand, the tableau when the tableau
+ * engine ran, and the pivot threads, which are kept between solves.
+ * A workspace is sized from n and m and reused by simplex_solve_in; once it
+ * is warm, further solves of the same size allocate nothing.
+ */
+struct SolverWorkspace {
+    int num_foods;
+    int num_nutrients;
+    Arena arena;
+    PivotPool* pool;
+    Tableau* tableau;
+    BasisFactor* factor;
+    int* basis;
+    double* x_basic;
+    double* y;
+    double* rho;
+    double* column;
+    double* work;
+    double* tau;
+    double* row_alpha;
+    double* row_cost;
+    double* perturbed_rhs;
+    int* basis_pos;     /* 1 + basis row of each basic column, 0 if nonbasic */
+    Pricing pricing;
+    SolveStats stats;   /* of the solve in progress */
+};
+
+/* Carves the engine arrays for an n x m problem from the arena; -1 if out of memory. */
+static int prepare_workspace(SolverWorkspace* ws, int num_foods, int num_nutrients) {
+    Arena* a = &ws->arena;
+    int m = num_nutrients;
+    size_t row_bytes = (size_t)(num_foods + m) * sizeof(double);
+    size_t col_bytes = (size_t)(num_foods + 2 * m) * sizeof(double);
+    ws->tableau = NULL;
+    ws->factor = arena_basis_factor(a, m);
+    ws->basis = (int*)arena_alloc(a, m * sizeof(int));
+    ws->x_basic = (double*)arena_alloc(a, m * sizeof(double));
+    ws->y = (double*)arena_alloc(a, m * sizeof(double));
+    ws->rho = (double*)arena_alloc(a, m * sizeof(double));
+    ws->column = (double*)arena_alloc(a, m * sizeof(double));
+    ws->work = (double*)arena_alloc(a, m * sizeof(double));
+    ws->tau = (double*)arena_alloc(a, m * sizeof(double));
+    ws->row_alpha = (double*)arena_alloc(a, row_bytes);
+    ws->row_cost = (double*)arena_alloc(a, row_bytes);
+    ws->perturbed_rhs = (double*)arena_alloc(a, m * sizeof(double));
+    ws->basis_pos = (int*)arena_alloc(a, (num_foods + 2 * m) * sizeof(int));
+    ws->pricing.column_weights = (double*)arena_alloc(a, col_bytes);
+    ws->pricing.row_weights = (double*)arena_alloc(a, m * sizeof(double));
+    
+    return ws->factor && ws->basis && ws->x_basic && ws->y && ws->rho && ws->column && ws->work && ws->tau &&
+           ws->row_alpha && ws->row_cost && ws->perturbed_rhs && ws->basis_pos && ws->pricing.column_weights &&
+           ws->pricing.row_weights ? 0 : -1;
+}
+
+SolverWorkspace* create_workspace(int num_foods, int num_nutrients) {
+    SolverWorkspace* ws = (SolverWorkspace*)calloc(1, sizeof(SolverWorkspace));
+    if (!ws) return NULL;
+    ws->num_foods = num_foods;
+    ws->num_nutrients = num_nutrients;
+    /* A dry run sizes the arena block for the engine arrays up front. */
+    prepare_workspace(ws, num_foods, num_nutrients);
+    arena_reset(&ws->arena);
+    return ws;
+}
+
+/* Heap blocks the workspace has taken so far; it stops growing once the workspace is warm. */
+long workspace_heap_allocations(const SolverWorkspace* ws) {
+    return ws->arena.heap_allocations;
+}
+
+void free_workspace(SolverWorkspace* ws) {
+    if (!ws) return;
+    free_pivot_pool(ws->pool);
+    free_arena(&ws->arena);
+    free(ws);
+}
+
+static void reset_solution(Solution* sol, int num_foods, int num_constraints) {
+    memset(sol->amounts, 0, num_foods * sizeof(double));
+    memset(sol->shadow_prices, 0, num_constraints * sizeof(double));
+    sol->total_cost = 0.0;
+    sol->feasible = 1;
+    sol->degenerate_pivots = 0;
+}
+
+/* Points `lp` at `problem` and at the engine arrays of a prepared workspace. */
+static void revised_attach(RevisedLP* lp, const DietProblem* problem, const double* requirements,
+                           SolverWorkspace* ws) {
+    lp->problem = problem;
+    lp->requirements = requirements;
+    lp->n = problem->num_foods;
+    lp->m = problem->num_nutrients;
+    lp->basis = ws->basis;
+    lp->x_basic = ws->x_basic;
+    lp->factor = ws->factor;
+    lp->y = ws->y;
+    lp->rho = ws->rho;
+    lp->column = ws->column;
+    lp->work = ws->work;
+    lp->tau = ws->tau;
+    lp->row_alpha = ws->row_alpha;
+    lp->row_cost = ws->row_cost;
+    lp->pricing = &ws->pricing;
+    lp->stats = &ws->stats;
+    lp->trace = NULL;
+    lp->trace_column = NULL;
+}
+
+/* Returns 0 when `sol` was filled (check sol->status), -1 when the basis became numerically singular. */
+static int revised_run(const DietProblem* problem, const double* requirements, SolverWorkspace* ws,
+                       const SolverOptions* opts, Solution* sol) {
+    int m = problem->num_nutrients;
+    int n = problem->num_foods;
+    int total_cols = n + 2 * m;
+    SolveBudget budget = make_budget(opts, n, m);
+    
+    RevisedLP lp;
+    revised_attach(&lp, problem, requirements, ws);
+    lp.trace = solve_trace(opts);
+    if (lp.trace && lp.trace->deltas) lp.trace_column = (double*)arena_alloc(&ws->arena, m * sizeof(double));
+    int* basis_pos = ws->basis_pos;
+    memset(basis_pos, 0, total_cols * sizeof(int));
+    long long clock = STATS_CLOCK();
+    long long factor_bytes = (long long)m * m * sizeof(double);
+    long long price_bytes = factor_bytes + (long long)matrix_bytes(problem);
+    
+    int phase = 2;
+    int status = SOLVE_OPTIMAL;
+    int iteration = 0;
+    int harris = opts->ratio_test == RATIO_HARRIS;
+    Degeneracy degeneracy;
+    reset_degeneracy(&degeneracy, opts->degeneracy);
+    reset_pricing(lp.pricing, opts->pricing, total_cols, m);
+    int warm = opts->warm_basis && revised_load_basis(&lp, opts->warm_basis, basis_pos);
+    
+    if (warm) {
+        STATS_LAP(lp.stats, PHASE_BUILD, clock, factor_bytes);
+        int primal_feasible = 1;
+        for (int i = 0; i < m; i++) {
+            if (lp.x_basic[i] < -EPSILON) primal_feasible = 0;
+        }
+        if (!primal_feasible && revised_dual_feasible(&lp, basis_pos)) {
+            trace_note(lp.trace, TRACE_START, 0, 0, SOLVE_OPTIMAL, revised_objective(&lp));
+            revised_init_dual_weights(&lp);
+            status = revised_dual_simplex(&lp, basis_pos, &iteration, &budget, harris, &degeneracy);
+            clock = STATS_CLOCK();
+        } else if (!primal_feasible) {
+            warm = 0;
+        } else {
+            trace_note(lp.trace, TRACE_START, 0, 2, SOLVE_OPTIMAL, revised_objective(&lp));
+        }
+    }
+    
+    if (!warm) {
+        memset(basis_pos, 0, total_cols * sizeof(int));
+        for (int i = 0; i < m; i++) {
+            if (requirements[i] > 0.0) {
+                lp.basis[i] = n + m + i;
+                phase = 1;
+            } else {
+                lp.basis[i] = n + i;
+            }
+            basis_pos[lp.basis[i]] = i + 1;
+        }
+        status = revised_refactor(&lp) ? SOLVE_OPTIMAL : -1;
+        /* B is diagonal with +-1 entries, so the exact edge norms are 1 + |a_j|^2. */
+        if (opts->pricing == PRICING_STEEPEST_EDGE) {
+            for (int j = 0; j < total_cols; j++) {
+                revised_column(&lp, j, lp.column);
+                double norm = 1.0;
+                for (int i = 0; i < m; i++) {
+                    norm += lp.column[i] * lp.column[i];
+                }
+                lp.pricing->column_weights[j] = norm;
+            }
+        }
+        STATS_LAP(lp.stats, PHASE_BUILD, clock, factor_bytes);
+        trace_note(lp.trace, TRACE_START, 0, phase, SOLVE_OPTIMAL, revised_objective(&lp));
+    }
+    
+    while (status == SOLVE_OPTIMAL) {
+        revised_duals(&lp, phase);
+        
+        double min_d = 0.0;
+        int bland = use_bland(&degeneracy);
+        int q = bland ? revised_price_bland(&lp, basis_pos, phase, &min_d) : revised_price(&lp, basis_pos, phase, &min_d);
+        STATS_LAP(lp.stats, PHASE_PRICING, clock, price_bytes);
+        
+        if (q == -1) {
+            if (phase == 2 && lp.requirements != requirements) {
+                /* Any infeasibility the original requirements leave is repaired by the dual simplex. */
+                revised_restore_requirements(&lp, requirements);
+                trace_note(lp.trace, TRACE_UNPERTURB, iteration, 0, SOLVE_OPTIMAL, revised_objective(&lp));
+                degeneracy.rule = DEGENERACY_BLAND;
+                degeneracy.stall = 0;
+                revised_init_dual_weights(&lp);
+                status = revised_dual_simplex(&lp, basis_pos, &iteration, &budget, harris, &degeneracy);
+                break;
+            }
+            if (phase == 2) break;
+            double infeasibility = 0.0;
+            for (int i = 0; i < m; i++) {
+                if (lp.basis[i] >= n + m) infeasibility += lp.x_basic[i];
+            }
+            if (infeasibility > EPSILON) {
+                status = SOLVE_INFEASIBLE;
+                break;
+            }
+            if (!revised_drive_out_artificials(&lp, basis_pos)) status = -1;
+            phase = 2;
+            trace_note(lp.trace, TRACE_PHASE_ONE_DONE, iteration, 2, SOLVE_OPTIMAL, revised_objective(&lp));
+            continue;
+        }
+        
+        status = budget_check(&budget, iteration);
+        if (status != SOLVE_OPTIMAL) break;
+        
+        if (phase == 2 && lp.requirements == requirements && should_perturb(&degeneracy)) {
+            revised_perturb(&lp, ws->perturbed_rhs, &degeneracy);
+            trace_note(lp.trace, TRACE_PERTURB, iteration, 2, SOLVE_OPTIMAL, revised_objective(&lp));
+        }
+        
+        revised_column(&lp, q, lp.column);
+        basis_ftran(lp.factor, lp.column, lp.work);
+        
+        int r;
+        if (bland) {
+            r = bland_ratio_test(lp.x_basic, lp.column, 1, m, lp.basis);
+        } else {
+            r = harris ? harris_ratio_test(lp.x_basic, lp.column, 1, m) : textbook_ratio_test(lp.x_basic, lp.column, 1, m);
+        }
+        STATS_LAP(lp.stats, PHASE_RATIO_TEST, clock, factor_bytes);
+        if (r == -1) {
+            status = SOLVE_UNBOUNDED;
+            break;
+        }
+        record_pivot(&degeneracy, lp.x_basic[r]);
+        
+        revised_update_primal_weights(&lp, basis_pos, phase, r, q);
+        basis_pos[lp.basis[r]] = 0;
+        basis_pos[q] = r + 1;
+        double pivot = lp.column[r];
+        if (lp.trace_column) memcpy(lp.trace_column, lp.column, m * sizeof(double));
+        if (!revised_pivot(&lp, r, q)) status = -1;
+        STATS_LAP(lp.stats, PHASE_PIVOT, clock, factor_bytes);
+        iteration++;
+        if (lp.trace && status != -1) revised_trace_pivot(&lp, iteration, phase, r, q, pivot);
+    }
+    
+    if (status == -1) {
+        trace_note(lp.trace, TRACE_END, iteration, phase, SOLVE_NUMERICAL_ERROR, NAN);
+        return -1;
+    }
+    if (lp.requirements != requirements) revised_restore_requirements(&lp, requirements);
+    trace_note(lp.trace, TRACE_END, iteration, phase, status, revised_objective(&lp));
+    
+    reset_solution(sol, n, m);
+    sol->status = (SolveStatus)status;
+    sol->iterations = iteration;
+    sol->degenerate_pivots = degeneracy.degenerate;
+    /*
+     * An artificial left basic at zero is exported as its row's surplus
+     * column, which is parallel to it and so cannot already be basic. That
+     * keeps the basis in [0, n+m) for warm starts and cost curves.
+     */
+    if (sol->basis) {
+        for (int i = 0; i < m; i++) {
+            sol->basis[i] = lp.basis[i] < n + m ? lp.basis[i] : lp.basis[i] - m;
+        }
+    }
+    
+    int primal_feasible = phase == 2;
+    double objective = 0.0;
+    for (int i = 0; i < m; i++) {
+        int col = lp.basis[i];
+        if (lp.x_basic[i] < -EPSILON) primal_feasible = 0;
+        objective += revised_cost(&lp, col, 2) * lp.x_basic[i];
+        if (col < n) {
+            sol->amounts[col] = fmax(0.0, lp.x_basic[i]);
+            sol->total_cost += sol->amounts[col] * problem->costs[col];
+        }
+    }
+    
+    int dual_feasible = phase == 2 && status != SOLVE_INFEASIBLE &&
+                        (status == SOLVE_OPTIMAL || revised_dual_feasible(&lp, basis_pos));
+    sol->feasible = primal_feasible && status != SOLVE_INFEASIBLE;
+    sol->primal_bound = sol->feasible ? sol->total_cost : INFINITY;
+    sol->dual_bound = dual_feasible ? objective : -INFINITY;
+    if (status == SOLVE_UNBOUNDED) sol->primal_bound = -INFINITY;
+    if (phase == 2 && status != SOLVE_INFEASIBLE) {
+        revised_duals(&lp, 2);
+        for (int i = 0; i < m; i++) {
+            sol->shadow_prices[i] = fmax(0.0, lp.y[i]);
+        }
+        if (sol->reduced_costs) {
+            for (int j = 0; j < n; j++) {
+                sol->reduced_costs[j] = basis_pos[j] ? 0.0 : revised_reduced_cost(&lp, j, 2);
+            }
+        }
+    }
+    STATS_LAP(lp.stats, PHASE_EXTRACTION, clock, price_bytes);
+    return 0;
+}
+
+/*
+ * Reads amounts, duals and reduced costs straight off the final basis: each
+ * basic food takes its row's right-hand side, every other food is zero.
+ */
+static void extract_tableau_solution(Tableau* t, const DietProblem* problem, Solution* sol) {
+    int n = problem->num_foods;
+    int m = problem->num_nutrients;
+    double* obj = tableau_row(t, m);
+    
+    for (int i = 0; i < m; i++) {
+        int col = t->basis[i];
+        if (col < n) {
+            sol->amounts[col] = fmax(0.0, TABLEAU_AT(t, i, t->cols - 1));
+            sol->total_cost += sol->amounts[col] * problem->costs[col];
+        }
+        sol->shadow_prices[i] = fmax(0.0, obj[n + i]);
+    }
+    
+    if (sol->reduced_costs) {
+        memcpy(sol->reduced_costs, obj, n * sizeof(double));
+        for (int i = 0; i < m; i++) {
+            if (t->basis[i] < n) sol->reduced_costs[t->basis[i]] = 0.0;
+        }
+    }
+}
+
+/* Shifts every nonbasic reduced cost up; dual feasibility and the objective value are unchanged. */
+static void perturb_tableau_costs(Tableau* t, Degeneracy* d) {
+    double* obj = tableau_row(t, t->rows - 1);
+    for (int j = 0; j < t->cols - 1; j++) {
+        obj[j] += perturbation(d, obj[j]);
+    }
+    for (int i = 0; i < t->rows - 1; i++) {
+        obj[t->basis[i]] = 0.0;
+    }
+}
+
+/* Shifts every basic value up, which keeps a feasible basis feasible. */
+static void perturb_tableau_rhs(Tableau* t, const double* costs, int num_foods, Degeneracy* d) {
+    double* obj = tableau_row(t, t->rows - 1);
+    for (int i = 0; i < t->rows - 1; i++) {
+        double* rhs = &TABLEAU_AT(t, i, t->cols - 1);
+        double delta = perturbation(d, *rhs);
+        *rhs += delta;
+        if (t->basis[i] < num_foods) obj[t->cols - 1] -= costs[t->basis[i]] * delta;
+    }
+}
+
+/*
+ * Rebuilds the right-hand sides and the objective row for the current basis
+ * from the original data: the surplus columns hold B^-1, so each right-hand
+ * side is B^-1 (-b), and the objective row is c minus c_B times each row.
+ */
+static void tableau_remove_perturbation(Tableau* t, const DietProblem* problem, const double* requirements) {
+    int n = problem->num_foods;
+    int m = problem->num_nutrients;
+    int rhs_col = t->cols - 1;
+    double* obj = tableau_row(t, m);
+    
+    for (int i = 0; i < m; i++) {
+        double* row = tableau_row(t, i);
+        double rhs = 0.0;
+        for (int k = 0; k < m; k++) {
+            rhs -= row[n + k] * requirements[k];
+        }
+        row[rhs_col] = rhs;
+    }
+    
+    for (int j = 0; j <= rhs_col; j++) {
+        obj[j] = j < n ? problem->costs[j] : 0.0;
+    }
+    for (int i = 0; i < m; i++) {
+        if (t->basis[i] >= n) continue;
+        double cost = problem->costs[t->basis[i]];
+        double* row = tableau_row(t, i);
+        for (int j = 0; j <= rhs_col; j++) {
+            obj[j] -= cost * row[j];
+        }
+    }
+    for (int i = 0; i < m; i++) {
+        obj[t->basis[i]] = 0.0;
+    }
+}
+
+static int tableau_run(const DietProblem* problem, const double* requirements, SolverWorkspace* ws,
+                       const SolverOptions* opts, Solution* sol) {
+    int num_foods = problem->num_foods;
+    int num_constraints = problem->num_nutrients;
+    int num_vars = num_foods;
+    int num_slack = num_constraints;
+    int total_cols = num_vars + num_slack + 1;
+    int total_rows = num_constraints + 1;
+    
+    /* Nonnegative costs make the all-surplus basis dual feasible; anything else needs a phase 1. */
+    for (int j = 0; j < num_foods; j++) {
+        if (problem->costs[j] < 0.0) return revised_run(problem, requirements, ws, opts, sol);
+    }
+    SolveBudget budget = make_budget(opts, num_foods, num_constraints);
+    SolveStats* stats = &ws->stats;
+    long long clock = STATS_CLOCK();
+    
+    ws->tableau = arena_tableau(&ws->arena, total_rows, total_cols);
+    Tableau* t = ws->tableau;
+    if (!t) return -1;
+    
+    for (int j = 0; j < num_foods; j++) {
+        if (problem->nutrients) {
+            const double* a = food_column(problem, j);
+            for (int i = 0; i < num_constraints; i++) {
+                TABLEAU_AT(t, i, j) = -a[i];
+            }
+        } else {
+            for (int k = problem->col_start[j]; k < problem->col_start[j + 1]; k++) {
+                TABLEAU_AT(t, problem->row_index[k], j) = -problem->values[k];
+            }
+        }
+    }
+    for (int i = 0; i < num_constraints; i++) {
+        double* row = tableau_row(t, i);
+        row[num_vars + i] = 1.0;
+        row[total_cols - 1] = -requirements[i];
+        t->basis[i] = num_vars + i;
+    }
+    
+    double* obj = tableau_row(t, total_rows - 1);
+    memcpy(obj, problem->costs, num_foods * sizeof(double));
+    
+    PivotPool* pool = NULL;
+    if (opts->num_threads > 1 && (long)total_rows * total_cols >= PARALLEL_PIVOT_MIN_CELLS) {
+        if (ws->pool && ws->pool->num_threads != opts->num_threads) {
+            free_pivot_pool(ws->pool);
+            ws->pool = NULL;
+        }
+        if (!ws->pool) ws->pool = create_pivot_pool(opts->num_threads);
+        pool = ws->pool;
+    }
+    long long row_bytes = (long long)total_cols * sizeof(double);
+    long long column_bytes = (long long)total_rows * sizeof(double);
+    STATS_LAP(stats, PHASE_BUILD, clock, total_rows * row_bytes);
+    
+    const PivotTrace* trace = solve_trace(opts);
+    double* trace_column = NULL;
+    if (trace && trace->deltas) trace_column = (double*)arena_alloc(&ws->arena, total_rows * sizeof(double));
+    trace_note(trace, TRACE_START, 0, 0, SOLVE_OPTIMAL, -obj[total_cols - 1]);
+    
+    int iteration = 0;
+    SolveStatus status = SOLVE_OPTIMAL;
+    Pricing* pricing = &ws->pricing;
+    reset_pricing(pricing, opts->pricing, total_cols - 1, num_constraints);
+    int harris = opts->ratio_test == RATIO_HARRIS;
+    double* rhs = &TABLEAU_AT(t, 0, total_cols - 1);
+    Degeneracy degeneracy;
+    reset_degeneracy(&degeneracy, opts->degeneracy);
+    int perturbed_costs = 0;
+    int perturbed_rhs = 0;
+    
+    for (;;) {
+        int bland = use_bland(&degeneracy);
+        int pivot_row = bland ? bland_dual_pivot_row(rhs, t->stride, num_constraints, t->basis)
+                              : price_tableau_row(t, pricing);
+        STATS_LAP(stats, PHASE_PRICING, clock, column_bytes);
+        int dual = pivot_row != -1;
+        int pivot_col;
+        double step;
+        
+        if (dual) {
+            if (!perturbed_costs && should_perturb(&degeneracy)) {
+                perturb_tableau_costs(t, &degeneracy);
+                perturbed_costs = 1;
+                trace_note(trace, TRACE_PERTURB, iteration, 0, SOLVE_OPTIMAL, -obj[total_cols - 1]);
+            }
+            if (bland) {
+                pivot_col = bland_dual_ratio_test(obj, tableau_row(t, pivot_row), total_cols - 1);
+            } else {
+                pivot_col = harris ? find_dual_pivot_column_harris(t, pivot_row) : find_dual_pivot_column(t, pivot_row);
+            }
+            STATS_LAP(stats, PHASE_RATIO_TEST, clock, 2 * row_bytes);
+            if (pivot_col == -1) {
+                status = SOLVE_INFEASIBLE;
+                break;
+            }
+            step = obj[pivot_col];
+        } else {
+            pivot_col = bland ? bland_pivot_column(obj, total_cols - 1) : price_tableau_column(t, pricing);
+            STATS_LAP(stats, PHASE_PRICING, clock, row_bytes);
+            if (pivot_col == -1 && (perturbed_costs || perturbed_rhs)) {
+                /* Finish on the original data; from here on only Bland's rule guards against stalls. */
+                tableau_remove_perturbation(t, problem, requirements);
+                perturbed_costs = perturbed_rhs = 0;
+                trace_note(trace, TRACE_UNPERTURB, iteration, 0, SOLVE_OPTIMAL, -obj[total_cols - 1]);
+                degeneracy.rule = DEGENERACY_BLAND;
+                degeneracy.stall = 0;
+                continue;
+            }
+            if (pivot_col == -1) break;
+            if (!perturbed_rhs && should_perturb(&degeneracy)) {
+                perturb_tableau_rhs(t, problem->costs, num_foods, &degeneracy);
+                perturbed_rhs = 1;
+                trace_note(trace, TRACE_PERTURB, iteration, 2, SOLVE_OPTIMAL, -obj[total_cols - 1]);
+            }
+            if (bland) {
+                pivot_row = bland_ratio_test(rhs, &TABLEAU_AT(t, 0, pivot_col), t->stride, num_constraints, t->basis);
+            } else {
+                pivot_row = harris ? find_pivot_row_harris(t, pivot_col) : find_pivot_row(t, pivot_col);
+            }
+            STATS_LAP(stats, PHASE_RATIO_TEST, clock, 2 * column_bytes);
+            if (pivot_row == -1) {
+                status = SOLVE_UNBOUNDED;
+                break;
+            }
+            step = TABLEAU_AT(t, pivot_row, total_cols - 1);
+        }
+        
+        status = budget_check(&budget, iteration);
+        if (status != SOLVE_OPTIMAL) break;
+        record_pivot(&degeneracy, step);
+        
+        update_tableau_devex(t, pricing, pivot_row, pivot_col);
+        double pivot = TABLEAU_AT(t, pivot_row, pivot_col);
+        for (int i = 0; trace_column && i < total_rows; i++) {
+            trace_column[i] = TABLEAU_AT(t, i, pivot_col);
+        }
+        parallel_pivot_operation(pool, t, pivot_row, pivot_col);
+        STATS_LAP(stats, PHASE_PIVOT, clock, total_rows * row_bytes);
+        iteration++;
+        
+        if (trace) {
+            PivotEvent e = { TRACE_PIVOT, iteration, dual ? 0 : 2, pivot_row, pivot_col, pivot, -obj[total_cols - 1],
+                             SOLVE_OPTIMAL, trace_column ? total_rows : 0, trace_column ? total_cols : 0,
+                             trace_column, trace_column ? tableau_row(t, pivot_row) : NULL };
+            trace->fn(&e, trace->user);
+        }
+    }
+    
+    if (perturbed_costs || perturbed_rhs) tableau_remove_perturbation(t, problem, requirements);
+    reset_solution(sol, num_foods, num_constraints);
+    sol->status = status;
+    sol->degenerate_pivots = degeneracy.degenerate;
+    
+    extract_tableau_solution(t, problem, sol);
+    
+    /* The objective row's right-hand side holds -z for the current basis. */
+    double objective = -obj[total_cols - 1];
+    sol->feasible = status != SOLVE_INFEASIBLE && find_dual_pivot_row(t) == -1;
+    sol->primal_bound = sol->feasible ? sol->total_cost : INFINITY;
+    sol->dual_bound = status != SOLVE_UNBOUNDED && find_pivot_column(t) == -1 ? objective : -INFINITY;
+    if (status == SOLVE_UNBOUNDED) sol->primal_bound = -INFINITY;
+    
+    sol->iterations = iteration;
+    if (sol->basis) memcpy(sol->basis, t->basis, num_constraints * sizeof(int));
+    STATS_LAP(stats, PHASE_EXTRACTION, clock, 2 * row_bytes + 2 * column_bytes);
+    trace_note(trace, TRACE_END, iteration, 0, status, objective);
+    return 0;
+}
+
+static int solve_into(const DietProblem* problem, const double* requirements, SolverWorkspace* ws,
+                      const SolverOptions* opts, Solution* sol) {
+    if (prepare_workspace(ws, problem->num_foods, problem->num_nutrients) != 0) return -1;
+    if (opts->engine == ENGINE_REVISED || opts->warm_basis) {
+        return revised_run(problem, requirements, ws, opts, sol);
+    }
+    return tableau_run(problem, requirements, ws, opts, sol);
+}
+
+/*
+ * Scaling. Nutrient rows mix units (mg, g, kcal, %DV), so the entries of one
+ * matrix can span many orders of magnitude while EPSILON is absolute. Before
+ * the engine runs, rows and columns are rescaled to A' = R A S: geometric-mean
+ * passes divide each row, then each column, by sqrt(min |a| * max |a|) until
+ * the spread stops shrinking by at least a factor SCALING_MIN_GAIN, then one
+ * equilibration pass divides each row and then each column by its largest
+ * entry. Every factor is a power of two, so scaling itself rounds nothing.
+ *
+ * The engine solves min (S c)'x' subject to A'x' >= R b, and its solution
+ * maps back as x = S x', y = R y' and d_j = d'_j / s_j; the basis is the same.
+ */
+#define SCALING_MAX_PASSES 8
+#define SCALING_MIN_GAIN 0.9
+
+typedef struct {
+    DietProblem* scaled;
+    double* row_scale;
+    double* col_scale;
+    ScalingStats stats;
+} Scaling;
+
+/* Column j of either layout: values[k] sits in row rows[k], or in row k when rows is NULL. */
+static int scaling_column(DietProblem* p, int j, double** values, const int** rows) {
+    if (p->nutrients) {
+        *values = food_column(p, j);
+        *rows = NULL;
+        return p->num_nutrients;
+    }
+    *values = p->values + p->col_start[j];
+    *rows = p->row_index + p->col_start[j];
+    return p->col_start[j + 1] - p->col_start[j];
+}
+
+/* The power of two nearest to x on a log scale. */
+static double nearest_power_of_two(double x) {
+    int e;
+    double f = frexp(x, &e);
+    return ldexp(1.0, f < 0.7071067811865476 ? e - 1 : e);
+}
+
+static double matrix_range(DietProblem* p) {
+    double lo = INFINITY;
+    double hi = 0.0;
+    for (int j = 0; j < p->num_foods; j++) {
+        double* values;
+        const int* rows;
+        int count = scaling_column(p, j, &values, &rows);
+        for (int k = 0; k < count; k++) {
+            double v = fabs(values[k]);
+            if (v == 0.0) continue;
+            if (v < lo) lo = v;
+            if (v > hi) hi = v;
+        }
+    }
+    return hi > 0.0 ? hi / lo : 1.0;
+}
+
+/*
+ * Scales every row, then every column, by a power of two: the inverse geometric
+ * mean of its extreme entries, or with `geometric` clear the inverse largest.
+ * lo, hi and factor are scratch of num_nutrients doubles. Returns the range
+ * of the scaled matrix, as matrix_range would.
+ */
+static double scaling_pass(Scaling* sc, double* lo, double* hi, double* factor, int geometric) {
+    DietProblem* p = sc->scaled;
+    int m = p->num_nutrients;
+    for (int i = 0; i < m; i++) {
+        lo[i] = INFINITY;
+        hi[i] = 0.0;
+    }
+    for (int j = 0; j < p->num_foods; j++) {
+        double* values;
+        const int* rows;
+        int count = scaling_column(p, j, &values, &rows);
+        for (int k = 0; k < count; k++) {
+            double v = fabs(values[k]);
+            int i = rows ? rows[k] : k;
+            if (v == 0.0) continue;
+            if (v < lo[i]) lo[i] = v;
+            if (v > hi[i]) hi[i] = v;
+        }
+    }
+    for (int i = 0; i < m; i++) {
+        factor[i] = hi[i] > 0.0 ? nearest_power_of_two(1.0 / (geometric ? sqrt(lo[i] * hi[i]) : hi[i])) : 1.0;
+        sc->row_scale[i] *= factor[i];
+    }
+    
+    double range_lo = INFINITY;
+    double range_hi = 0.0;
+    for (int j = 0; j < p->num_foods; j++) {
+        double* values;
+        const int* rows;
+        int count = scaling_column(p, j, &values, &rows);
+        double col_lo = INFINITY;
+        double col_hi = 0.0;
+        for (int k = 0; k < count; k++) {
+            values[k] *= factor[rows ? rows[k] : k];
+            double v = fabs(values[k]);
+            if (v == 0.0) continue;
+            if (v < col_lo) col_lo = v;
+            if (v > col_hi) col_hi = v;
+        }
+        if (col_hi == 0.0) continue;
+        double f = nearest_power_of_two(1.0 / (geometric ? sqrt(col_lo * col_hi) : col_hi));
+        for (int k = 0; k < count; k++) {
+            values[k] *= f;
+        }
+        sc->col_scale[j] *= f;
+        if (col_lo * f < range_lo) range_lo = col_lo * f;
+        if (col_hi * f > range_hi) range_hi = col_hi * f;
+    }
+    return range_hi > 0.0 ? range_hi / range_lo : 1.0;
+}
+
+/* A scaled copy of `problem` in the same layout, with the factors that undo it, all in `a`. NULL if out of memory. */
+static Scaling* create_scaling(Arena* a, const DietProblem* problem) {
+    long long start = monotonic_ns();
+    int n = problem->num_foods;
+    int m = problem->num_nutrients;
+    Scaling* sc = (Scaling*)arena_alloc(a, sizeof(Scaling));
+    double* scratch = (double*)arena_alloc(a, 3 * (size_t)m * sizeof(double));
+    if (!sc || !scratch) return NULL;
+    sc->scaled = arena_copy_diet_problem(a, problem, problem->nutrients == NULL);
+    sc->row_scale = (double*)arena_alloc(a, m * sizeof(double));
+    sc->col_scale = (double*)arena_alloc(a, n * sizeof(double));
+    if (!sc->scaled || !sc->row_scale || !sc->col_scale) return NULL;
+    for (int i = 0; i < m; i++) sc->row_scale[i] = 1.0;
+    for (int j = 0; j < n; j++) sc->col_scale[j] = 1.0;
+    
+    double range = matrix_range(sc->scaled);
+    sc->stats.range_before = range;
+    sc->stats.passes = 0;
+    while (sc->stats.passes < SCALING_MAX_PASSES) {
+        double next = scaling_pass(sc, scratch, scratch + m, scratch + 2 * m, 1);
+        sc->stats.passes++;
+        int stalled = next > SCALING_MIN_GAIN * range;
+        range = next;
+        if (stalled) break;
+    }
+    sc->stats.range_after = scaling_pass(sc, scratch, scratch + m, scratch + 2 * m, 0);
+    
+    for (int j = 0; j < n; j++) sc->scaled->costs[j] *= sc->col_scale[j];
+    for (int i = 0; i < m; i++) sc->scaled->requirements[i] *= sc->row_scale[i];
+    sc->stats.elapsed_ns = monotonic_ns() - start;
+    return sc;
+}
+
+static void scale_requirements(const Scaling* sc, const double* requirements, double* out) {
+    for (int i = 0; i < sc->scaled->num_nutrients; i++) {
+        out[i] = requirements[i] * sc->row_scale[i];
+    }
+}
+
+/* Maps a solution of the scaled problem back to the original units; costs and the basis carry over. */
+static void unscale_solution(const Scaling* sc, Solution* sol) {
+    for (int j = 0; j < sc->scaled->num_foods; j++) {
+        sol->amounts[j] *= sc->col_scale[j];
+        if (sol->reduced_costs) sol->reduced_costs[j] /= sc->col_scale[j];
+    }
+    for (int i = 0; i < sc->scaled->num_nutrients; i++) {
+        sol->shadow_prices[i] *= sc->row_scale[i];
+    }
+    sol->scaling = sc->stats;
+}
+
+/* solve_into on problem->requirements, through a scaled copy when opts->scaling is set. */
+static int solve_scaled(const DietProblem* problem, SolverWorkspace* ws, const SolverOptions* opts, Solution* sol) {
+    if (!opts->scaling) return solve_into(problem, problem->requirements, ws, opts, sol);
+    
+    long long clock = STATS_CLOCK();
+    Scaling* sc = create_scaling(&ws->arena, problem);
+    if (!sc) return -1;
+    long long scaled_bytes = (sc->stats.passes + 2) * (long long)matrix_bytes(problem);
+    STATS_LAP(&ws->stats, PHASE_SCALING, clock, scaled_bytes);
+    if (opts->verbose) {
+        printf("\nScaling: |a| range %.1e reduced to %.1e in %d geometric passes\n",
+               sc->stats.range_before, sc->stats.range_after, sc->stats.passes);
+    }
+    int failed = solve_into(sc->scaled, sc->scaled->requirements, ws, opts, sol);
+    clock = STATS_CLOCK();
+    if (!failed) unscale_solution(sc, sol);
+    STATS_LAP(&ws->stats, PHASE_SCALING, clock, 0);
+    return failed;
+}
+
+/*
+ * Presolve. Before the engines run, simplex_solve strips what a diet
+ * catalogue does not need:
+ *
+ * - nutrients that x >= 0 already satisfies: no negative entries and a
+ *   requirement of at most zero, which covers empty rows;
+ * - singleton nutrients a_ij x_j >= b_i with a_ij > 0, which become a lower
+ *   bound on x_j that is then shifted out of every requirement;
+ * - foods with no nutrients left, which stay at their lower bound;
+ * - zero-cost foods that supply a single nutrient, which cover it for free
+ *   and take its row with them;
+ * - dominated foods: k dominates j when it supplies at least as much of every
+ *   remaining nutrient per dollar, a_ik / c_k >= a_ij / c_j. Foods with
+ *   identical ratios are duplicates, and only the first is kept.
+ *
+ * Every reduction is pushed on a stack that postsolve replays backwards to
+ * rebuild amounts, duals, reduced costs and a basis in the original indices.
+ * Each food is checked against at most PRESOLVE_DOMINANCE_SCAN kept foods,
+ * those with the most nutrients per dollar, so a pass stays linear in n.
+ */
+#define PRESOLVE_DOMINANCE_SCAN 256
+#define PRESOLVE_MAX_PASSES 8
+
+typedef enum {
+    PRESOLVE_REDUNDANT_ROW,
+    PRESOLVE_SINGLETON_ROW,
+    PRESOLVE_EMPTY_FOOD,
+    PRESOLVE_FREE_SINGLETON,
+    PRESOLVE_DOMINATED_FOOD
+} PresolveOp;
+
+typedef struct {
+    PresolveOp op;
+    int row;
+    int food;
+} PresolveStep;
+
+typedef struct {
+    Arena* arena;                   /* holds everything below */
+    const DietProblem* problem;     /* the original in CSC form */
+    DietProblem* reduced;
+    int* row_start;                 /* CSR transpose of the original matrix */
+    int* row_food;
+    double* row_value;
+    int* food_alive;
+    int* row_alive;
+    int* food_count;                /* nonzeros of each live food in live rows */
+    int* row_count;                 /* nonzeros of each live row in live foods */
+    int* row_negative;              /* ... of which are negative */
+    double* lower;
+    double* rhs;                    /* requirements less the lower bounds */
+    int* food_map;                  /* reduced food -> original */
+    int* row_map;                   /* reduced nutrient -> original */
+    PresolveStep* steps;
+    int num_steps;
+    PresolveStats stats;
+} Presolve;
+
+typedef struct {
+    double key;
+    int food;
+} DominanceKey;
+
+static void presolve_push(Presolve* pre, PresolveOp op, int row, int food) {
+    PresolveStep step = { op, row, food };
+    pre->steps[pre->num_steps++] = step;
+}
+
+static void presolve_remove_row(Presolve* pre, int i) {
+    pre->row_alive[i] = 0;
+    for (int e = pre->row_start[i]; e < pre->row_start[i + 1]; e++) {
+        if (pre->row_value[e] != 0.0 && pre->food_alive[pre->row_food[e]]) pre->food_count[pre->row_food[e]]--;
+    }
+}
+
+static void presolve_remove_food(Presolve* pre, int j) {
+    const DietProblem* p = pre->problem;
+    pre->food_alive[j] = 0;
+    for (int e = p->col_start[j]; e < p->col_start[j + 1]; e++) {
+        int i = p->row_index[e];
+        if (p->values[e] == 0.0 || !pre->row_alive[i]) continue;
+        pre->row_count[i]--;
+        if (p->values[e] < 0.0) pre->row_negative[i]--;
+    }
+}
+
+/* Redundant and singleton rows; returns whether anything was removed. */
+static int presolve_rows(Presolve* pre) {
+    const DietProblem* p = pre->problem;
+    int changed = 0;
+    
+    for (int i = 0; i < p->num_nutrients; i++) {
+        if (!pre->row_alive[i]) continue;
+        if (pre->row_negative[i] == 0 && pre->rhs[i] <= 0.0) {
+            presolve_remove_row(pre, i);
+            presolve_push(pre, PRESOLVE_REDUNDANT_ROW, i, -1);
+            pre->stats.redundant_nutrients++;
+            changed = 1;
+            continue;
+        }
+        if (pre->row_count[i] != 1) continue;
+        
+        int j = -1;
+        double a = 0.0;
+        for (int e = pre->row_start[i]; e < pre->row_start[i + 1]; e++) {
+            if (pre->row_value[e] != 0.0 && pre->food_alive[pre->row_food[e]]) {
+                j = pre->row_food[e];
+                a = pre->row_value[e];
+            }
+        }
+        if (a <= 0.0) continue;
+        
+        double shift = pre->rhs[i] / a;
+        pre->lower[j] += shift;
+        for (int e = p->col_start[j]; e < p->col_start[j + 1]; e++) {
+            pre->rhs[p->row_index[e]] -= p->values[e] * shift;
+        }
+        presolve_remove_row(pre, i);
+        presolve_push(pre, PRESOLVE_SINGLETON_ROW, i, j);
+        pre->stats.singleton_nutrients++;
+        changed = 1;
+    }
+    return changed;
+}
+
+/* Empty foods and zero-cost singleton foods. */
+static int presolve_foods(Presolve* pre) {
+    const DietProblem* p = pre->problem;
+    int changed = 0;
+    
+    for (int j = 0; j < p->num_foods; j++) {
+        if (!pre->food_alive[j]) continue;
+        if (pre->food_count[j] == 0 && p->costs[j] >= 0.0) {
+            presolve_remove_food(pre, j);
+            presolve_push(pre, PRESOLVE_EMPTY_FOOD, -1, j);
+            pre->stats.empty_foods++;
+            changed = 1;
+        } else if (pre->food_count[j] == 1 && p->costs[j] == 0.0) {
+            int row = -1;
+            for (int e = p->col_start[j]; e < p->col_start[j + 1]; e++) {
+                if (p->values[e] > 0.0 && pre->row_alive[p->row_index[e]]) row = p->row_index[e];
+            }
+            if (row == -1) continue;
+            presolve_remove_food(pre, j);
+            presolve_remove_row(pre, row);
+            presolve_push(pre, PRESOLVE_FREE_SINGLETON, row, j);
+            pre->stats.free_singleton_foods++;
+            changed = 1;
+        }
+    }
+    return changed;
+}
+
+static int compare_dominance_keys(const void* a, const void* b) {
+    const DominanceKey* x = (const DominanceKey*)a;
+    const DominanceKey* y = (const DominanceKey*)b;
+    if (x->key != y->key) return x->key > y->key ? -1 : 1;
+    return x->food - y->food;
+}
+
+/* 0 if k does not dominate j, 1 if it does, 2 if the two are duplicates. */
+static int presolve_dominates(const Presolve* pre, int k, int j) {
+    const DietProblem* p = pre->problem;
+    int ek = p->col_start[k];
+    int end_k = p->col_start[k + 1];
+    int equal = pre->food_count[k] == pre->food_count[j];
+    
+    for (int e = p->col_start[j]; e < p->col_start[j + 1]; e++) {
+        int i = p->row_index[e];
+        if (p->values[e] == 0.0 || !pre->row_alive[i]) continue;
+        while (ek < end_k && p->row_index[ek] < i) ek++;
+        double a_k = ek < end_k && p->row_index[ek] == i ? p->values[ek] : 0.0;
+        double supplied = a_k * p->costs[j];
+        double needed = p->values[e] * p->costs[k];
+        if (supplied < needed) return 0;
+        if (supplied != needed) equal = 0;
+    }
+    return equal ? 2 : 1;
+}
+
+static int presolve_dominated(Presolve* pre) {
+    const DietProblem* p = pre->problem;
+    int n = p->num_foods;
+    DominanceKey* keys = (DominanceKey*)arena_alloc(pre->arena, n * sizeof(DominanceKey));
+    unsigned long long* signature = (unsigned long long*)arena_alloc(pre->arena, n * sizeof(unsigned long long));
+    int* kept = (int*)arena_alloc(pre->arena, n * sizeof(int));
+    unsigned long long* kept_signature = (unsigned long long*)arena_alloc(pre->arena,
+                                                                          n * sizeof(unsigned long long));
+    if (!keys || !signature || !kept || !kept_signature) return 0;
+    int count = 0;
+    
+    /* Candidates have a positive cost and no negative entry in a live row. */
+    for (int j = 0; j < n; j++) {
+        if (!pre->food_alive[j] || p->costs[j] <= 0.0 || pre->food_count[j] == 0) continue;
+        double per_dollar = 0.0;
+        int candidate = 1;
+        signature[j] = 0;
+        for (int e = p->col_start[j]; e < p->col_start[j + 1]; e++) {
+            int i = p->row_index[e];
+            if (p->values[e] == 0.0 || !pre->row_alive[i]) continue;
+            if (p->values[e] < 0.0) candidate = 0;
+            per_dollar += p->values[e];
+            signature[j] |= 1ULL << (i & 63);
+        }
+        if (!candidate) continue;
+        keys[count].key = per_dollar / p->costs[j];
+        keys[count].food = j;
+        count++;
+    }
+    qsort(keys, count, sizeof(DominanceKey), compare_dominance_keys);
+    
+    int num_kept = 0;
+    int changed = 0;
+    for (int c = 0; c < count; c++) {
+        int j = keys[c].food;
+        int verdict = 0;
+        int scan = num_kept < PRESOLVE_DOMINANCE_SCAN ? num_kept : PRESOLVE_DOMINANCE_SCAN;
+        /*
+         * k needs a nonzero wherever j has one; the signatures hash rows onto
+         * 64 bits. Blocks of 8 are screened without branches, since almost
+         * every kept food fails the test.
+         */
+        for (int f = 0; f < scan && !verdict; f += 8) {
+            int end = f + 8 < scan ? f + 8 : scan;
+            int any = 0;
+            for (int g = f; g < end; g++) {
+                any |= (signature[j] & ~kept_signature[g]) == 0;
+            }
+            for (int g = f; any && g < end && !verdict; g++) {
+                if ((signature[j] & ~kept_signature[g]) == 0) verdict = presolve_dominates(pre, kept[g], j);
+            }
+        }
+        if (!verdict) {
+            kept_signature[num_kept] = signature[j];
+            kept[num_kept++] = j;
+            continue;
+        }
+        presolve_remove_food(pre, j);
+        presolve_push(pre, PRESOLVE_DOMINATED_FOOD, -1, j);
+        if (verdict == 2) {
+            pre->stats.duplicate_foods++;
+        } else {
+            pre->stats.dominated_foods++;
+        }
+        changed = 1;
+    }
+    
+    return changed;
+}
+
+/* Builds the reduced CSC problem from the live rows and foods. */
+static DietProblem* presolve_build_reduced(Presolve* pre) {
+    const DietProblem* p = pre->problem;
+    int n = 0;
+    int m = 0;
+    int nnz = 0;
+    int* new_row = (int*)arena_alloc(pre->arena, p->num_nutrients * sizeof(int));
+    if (!new_row) return NULL;
+    
+    for (int i = 0; i < p->num_nutrients; i++) {
+        new_row[i] = pre->row_alive[i] ? m : -1;
+        if (pre->row_alive[i]) pre->row_map[m++] = i;
+    }
+    for (int j = 0; j < p->num_foods; j++) {
+        if (!pre->food_alive[j]) continue;
+        pre->food_map[n++] = j;
+        for (int e = p->col_start[j]; e < p->col_start[j + 1]; e++) {
+            if (p->values[e] != 0.0 && pre->row_alive[p->row_index[e]]) nnz++;
+        }
+    }
+    
+    DietProblem* r = arena_diet_problem(pre->arena, n, m, 1, nnz);
+    if (r) {
+        int k = 0;
+        for (int c = 0; c < n; c++) {
+            int j = pre->food_map[c];
+            r->costs[c] = p->costs[j];
+            r->col_start[c] = k;
+            for (int e = p->col_start[j]; e < p->col_start[j + 1]; e++) {
+                if (p->values[e] == 0.0 || !pre->row_alive[p->row_index[e]]) continue;
+                r->row_index[k] = new_row[p->row_index[e]];
+                r->values[k++] = p->values[e];
+            }
+        }
+        r->col_start[n] = k;
+        for (int i = 0; i < m; i++) {
+            r->requirements[i] = pre->rhs[pre->row_map[i]];
+        }
+    }
+    
+    pre->stats.num_foods = n;
+    pre->stats.num_nutrients = m;
+    pre->stats.nnz = nnz;
+    return r;
+}
+
+/* Everything lives in `a`, so nothing needs freeing. NULL if out of memory. */
+static Presolve* presolve(Arena* a, const DietProblem* problem) {
+    Presolve* pre = (Presolve*)arena_calloc(a, sizeof(Presolve));
+    if (!pre) return NULL;
+    pre->arena = a;
+    const DietProblem* p = problem->nutrients ? arena_copy_diet_problem(a, problem, 1) : problem;
+    if (!p) return NULL;
+    int n = p->num_foods;
+    int m = p->num_nutrients;
+    int nnz = p->col_start[n];
+    pre->problem = p;
+    
+    pre->row_start = (int*)arena_calloc(a, (m + 1) * sizeof(int));
+    pre->row_food = (int*)arena_alloc(a, nnz * sizeof(int));
+    pre->row_value = (double*)arena_alloc(a, nnz * sizeof(double));
+    pre->food_alive = (int*)arena_alloc(a, n * sizeof(int));
+    pre->row_alive = (int*)arena_alloc(a, m * sizeof(int));
+    pre->food_count = (int*)arena_calloc(a, n * sizeof(int));
+    pre->row_count = (int*)arena_calloc(a, m * sizeof(int));
+    pre->row_negative = (int*)arena_calloc(a, m * sizeof(int));
+    pre->lower = (double*)arena_calloc(a, n * sizeof(double));
+    pre->rhs = (double*)arena_alloc(a, m * sizeof(double));
+    pre->food_map = (int*)arena_alloc(a, n * sizeof(int));
+    pre->row_map = (int*)arena_alloc(a, m * sizeof(int));
+    pre->steps = (PresolveStep*)arena_alloc(a, (n + m) * sizeof(PresolveStep));
+    if (!pre->row_start || !pre->row_food || !pre->row_value || !pre->food_alive || !pre->row_alive ||
+        !pre->food_count || !pre->row_count || !pre->row_negative || !pre->lower || !pre->rhs ||
+        !pre->food_map || !pre->row_map || !pre->steps) {
+        return NULL;
+    }
+    
+    for (int e = 0; e < nnz; e++) {
+        pre->row_start[p->row_index[e] + 1]++;
+    }
+    for (int i = 0; i < m; i++) {
+        pre->row_start[i + 1] += pre->row_start[i];
+        pre->row_alive[i] = 1;
+    }
+    memcpy(pre->rhs, p->requirements, m * sizeof(double));
+    for (int j = 0; j < n; j++) {
+        pre->food_alive[j] = 1;
+        for (int e = p->col_start[j]; e < p->col_start[j + 1]; e++) {
+            int i = p->row_index[e];
+            int slot = pre->row_start[i] + pre->row_count[i]++;
+            pre->row_food[slot] = j;
+            pre->row_value[slot] = p->values[e];
+        }
+    }
+    memset(pre->row_count, 0, m * sizeof(int));
+    for (int j = 0; j < n; j++) {
+        for (int e = p->col_start[j]; e < p->col_start[j + 1]; e++) {
+            if (p->values[e] == 0.0) continue;
+            pre->food_count[j]++;
+            pre->row_count[p->row_index[e]]++;
+            if (p->values[e] < 0.0) pre->row_negative[p->row_index[e]]++;
+        }
+    }
+    
+    /*
+     * Row and food reductions feed each other, and removing dominated foods
+     * can expose new singletons. Dominance among the remaining foods only
+     * changes when rows go, so it is rerun only then.
+     */
+    for (int pass = 0; pass < PRESOLVE_MAX_PASSES; pass++) {
+        int rows_before = pre->stats.redundant_nutrients + pre->stats.singleton_nutrients +
+                          pre->stats.free_singleton_foods;
+        while (presolve_rows(pre) | presolve_foods(pre)) {
+        }
+        int rows_removed = pre->stats.redundant_nutrients + pre->stats.singleton_nutrients +
+                           pre->stats.free_singleton_foods != rows_before;
+        if (pass > 0 && !rows_removed) break;
+        if (!presolve_dominated(pre)) break;
+    }
+    
+    pre->reduced = presolve_build_reduced(pre);
+    return pre->reduced ? pre : NULL;
+}
+
+/* Maps the reduced solution onto the original foods and nutrients, replaying the reductions backwards. */
+static int postsolve(const Presolve* pre, const Solution* reduced, Solution* sol) {
+    const DietProblem* p = pre->problem;
+    const DietProblem* r = pre->reduced;
+    int n = p->num_foods;
+    int m = p->num_nutrients;
+    int* basic = (int*)arena_calloc(pre->arena, n * sizeof(int));
+    if (!basic) return -1;
+    
+    memcpy(sol->amounts, pre->lower, n * sizeof(double));
+    memset(sol->shadow_prices, 0, m * sizeof(double));
+    for (int c = 0; c < r->num_foods; c++) {
+        sol->amounts[pre->food_map[c]] += reduced->amounts[c];
+    }
+    for (int i = 0; i < r->num_nutrients; i++) {
+        int col = reduced->basis[i];
+        if (col < r->num_foods) {
+            col = pre->food_map[col];
+            basic[col] = 1;
+        } else if (col < r->num_foods + r->num_nutrients) {
+            col = n + pre->row_map[col - r->num_foods];
+        } else {
+            /* A basic artificial stands in for its row's surplus, as in the revised engine's export. */
+            col = n + pre->row_map[col - r->num_foods - r->num_nutrients];
+        }
+        sol->basis[pre->row_map[i]] = col;
+        sol->shadow_prices[pre->row_map[i]] = reduced->shadow_prices[i];
+    }
+    
+    for (int s = pre->num_steps - 1; s >= 0; s--) {
+        int i = pre->steps[s].row;
+        int j = pre->steps[s].food;
+        switch (pre->steps[s].op) {
+            case PRESOLVE_REDUNDANT_ROW:
+                sol->basis[i] = n + i;
+                break;
+            case PRESOLVE_SINGLETON_ROW: {
+                /* x_j sits at the bound this row set unless it is basic; the row's dual then zeroes d_j. */
+                if (basic[j]) {
+                    sol->basis[i] = n + i;
+                    break;
+                }
+                double d = p->costs[j];
+                double a = 0.0;
+                for (int e = p->col_start[j]; e < p->col_start[j + 1]; e++) {
+                    d -= p->values[e] * sol->shadow_prices[p->row_index[e]];
+                    if (p->row_index[e] == i) a = p->values[e];
+                }
+                sol->shadow_prices[i] = fmax(0.0, d) / a;
+                sol->basis[i] = j;
+                basic[j] = 1;
+                break;
+            }
+            case PRESOLVE_FREE_SINGLETON: {
+                double supplied = 0.0;
+                double a = 0.0;
+                for (int e = pre->row_start[i]; e < pre->row_start[i + 1]; e++) {
+                    if (pre->row_food[e] == j) {
+                        a = pre->row_value[e];
+                    } else {
+                        supplied += pre->row_value[e] * sol->amounts[pre->row_food[e]];
+                    }
+                }
+                /* x_j covers whatever the row still lacks, but never drops below an earlier bound. */
+                double needed = (p->requirements[i] - supplied) / a;
+                if (needed > pre->lower[j]) {
+                    sol->amounts[j] = needed;
+                    sol->basis[i] = j;
+                    basic[j] = 1;
+                } else {
+                    sol->amounts[j] = pre->lower[j];
+                    sol->basis[i] = n + i;
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+    
+    double shift = 0.0;
+    sol->total_cost = 0.0;
+    for (int j = 0; j < n; j++) {
+        sol->total_cost += p->costs[j] * sol->amounts[j];
+        shift += p->costs[j] * pre->lower[j];
+        if (!sol->reduced_costs) continue;
+        double d = p->costs[j];
+        for (int e = p->col_start[j]; e < p->col_start[j + 1] && !basic[j]; e++) {
+            d -= p->values[e] * sol->shadow_prices[p->row_index[e]];
+        }
+        sol->reduced_costs[j] = basic[j] ? 0.0 : d;
+    }
+    
+    sol->feasible = reduced->feasible;
+    sol->status = reduced->status;
+    sol->iterations = reduced->iterations;
+    sol->degenerate_pivots = reduced->degenerate_pivots;
+    sol->primal_bound = isfinite(reduced->primal_bound) ? sol->total_cost : reduced->primal_bound;
+    sol->dual_bound = reduced->dual_bound + shift;
+    sol->presolve = pre->stats;
+    sol->scaling = reduced->scaling;
+    return 0;
+}
+
+/* Presolve, solve the reduced problem with the requested engine, postsolve into `sol`. -1 if the engine failed. */
+static int presolve_and_solve(const DietProblem* problem, SolverWorkspace* ws, const SolverOptions* opts,
+                              Solution* sol) {
+    long long start = monotonic_ns();
+    long long clock = STATS_CLOCK();
+    Presolve* pre = presolve(&ws->arena, problem);
+    if (!pre) return -1;
+    pre->stats.elapsed_ns = monotonic_ns() - start;
+    STATS_LAP(&ws->stats, PHASE_PRESOLVE, clock, 3 * (long long)matrix_bytes(problem));
+    DietProblem* r = pre->reduced;
+    if (opts->verbose) {
+        printf("\nPresolve: %d x %d reduced to %d x %d\n", problem->num_foods, problem->num_nutrients,
+               r->num_foods, r->num_nutrients);
+    }
+    
+    /* With no requirement left, buying nothing more is optimal. */
+    Solution* reduced = arena_solution(&ws->arena, r->num_foods, r->num_nutrients);
+    if (!reduced) return -1;
+    if (r->num_nutrients > 0 && solve_scaled(r, ws, opts, reduced) != 0) return -1;
+    clock = STATS_CLOCK();
+    int failed = postsolve(pre, reduced, sol);
+    STATS_LAP(&ws->stats, PHASE_POSTSOLVE, clock, (long long)matrix_bytes(problem));
+    return failed;
+}
+
+/* out[r] = (row r of `rows`) . a_col for `count` rows stored interleaved: rows[i * count + r]. */
+static void revised_dot_rows(const RevisedLP* lp, int col, const double* rows, int count, double* out) {
+    const DietProblem* p = lp->problem;
+    memset(out, 0, count * sizeof(double));
+    if (col < lp->n && p->nutrients) {
+        const double* a = food_column(p, col);
+        for (int i = 0; i < lp->m; i++) {
+            if (a[i] == 0.0) continue;
+            for (int r = 0; r < count; r++) out[r] += rows[(size_t)i * count + r] * a[i];
+        }
+    } else if (col < lp->n) {
+        for (int k = p->col_start[col]; k < p->col_start[col + 1]; k++) {
+            const double* row = rows + (size_t)p->row_index[k] * count;
+            for (int r = 0; r < count; r++) out[r] += row[r] * p->values[k];
+        }
+    } else {
+        const double* row = rows + (size_t)(col - lp->n) * count;
+        for (int r = 0; r < count; r++) out[r] = -row[r];
+    }
+}
+
+/*
+ * Ranging from the optimal basis B, one factorization and no re-solve. A
+ * requirement moves x_B along B^-1 e_i, so its range ends where the first
+ * basic amount reaches zero. A basic food's price moves every reduced cost
+ * d_k by -alpha_k, alpha being the food's row of B^-1 A, so its range ends
+ * where the first d_k reaches zero; the rows of all basic foods are priced in
+ * one pass over A. A nonbasic food's price can rise freely and fall by d_j.
+ * O(m^3 + m nnz) in all. Entries of B^-1 e_i below RANGING_TOLERANCE times
+ * its largest count as zero; requirements can be large enough that a fixed
+ * cutoff would miss a real breakpoint.
+ */
+#define RANGING_TOLERANCE 1e-9
+
+static void compute_ranging(const DietProblem* problem, SolverWorkspace* ws, const SolverOptions* opts,
+                            Solution* sol) {
+    int n = problem->num_foods;
+    int m = problem->num_nutrients;
+    for (int j = 0; j < n; j++) {
+        sol->cost_lower[j] = sol->cost_upper[j] = NAN;
+    }
+    for (int i = 0; i < m; i++) {
+        sol->requirement_lower[i] = sol->requirement_upper[i] = NAN;
+    }
+    if (!opts->ranging || sol->status != SOLVE_OPTIMAL || !sol->feasible || prepare_workspace(ws, n, m) != 0) {
+        return;
+    }
+    double* rows = (double*)arena_alloc(&ws->arena, (size_t)m * m * sizeof(double));
+    double* up = (double*)arena_alloc(&ws->arena, m * sizeof(double));
+    double* down = (double*)arena_alloc(&ws->arena, m * sizeof(double));
+    double* row_scale = (double*)arena_alloc(&ws->arena, m * sizeof(double));
+    double* col_scale = (double*)arena_alloc(&ws->arena, m * sizeof(double));
+    int* foods = (int*)arena_alloc(&ws->arena, m * sizeof(int));
+    if (!rows || !up || !down || !row_scale || !col_scale || !foods) return;
+    RevisedLP lp;
+    revised_attach(&lp, problem, problem->requirements, ws);
+    int* basis_pos = ws->basis_pos;
+    memset(basis_pos, 0, (n + 2 * m) * sizeof(int));
+    
+    /*
+     * The solve may have run on a scaled copy, so B is equilibrated here
+     * before it is factorized: B' = R B C with R and C powers of two, and
+     * B^-1 = C B'^-1 R. The ratios below come out in the caller's units.
+     */
+    double* lu = lp.factor->lu;
+    for (int r = 0; r < m; r++) {
+        int col = sol->basis[r];
+        if (col < 0 || col >= n + m || basis_pos[col]) return;
+        basis_pos[col] = r + 1;
+        lp.basis[r] = col;
+        revised_column(&lp, col, lp.column);
+        for (int i = 0; i < m; i++) {
+            lu[(size_t)i * m + r] = lp.column[i];
+        }
+    }
+    for (int i = 0; i < m; i++) {
+        double hi = 0.0;
+        for (int r = 0; r < m; r++) hi = fmax(hi, fabs(lu[(size_t)i * m + r]));
+        row_scale[i] = hi > 0.0 ? nearest_power_of_two(1.0 / hi) : 1.0;
+    }
+    for (int r = 0; r < m; r++) {
+        double hi = 0.0;
+        for (int i = 0; i < m; i++) hi = fmax(hi, fabs(lu[(size_t)i * m + r]) * row_scale[i]);
+        col_scale[r] = hi > 0.0 ? nearest_power_of_two(1.0 / hi) : 1.0;
+        for (int i = 0; i < m; i++) lu[(size_t)i * m + r] *= row_scale[i] * col_scale[r];
+    }
+    if (!basis_factorize(lp.factor)) return;
+    
+    /* x' = B'^-1 R b and x = C x', so x_k / tau_k needs no unscaling. */
+    for (int i = 0; i < m; i++) {
+        lp.x_basic[i] = problem->requirements[i] * row_scale[i];
+    }
+    basis_ftran(lp.factor, lp.x_basic, lp.work);
+    for (int i = 0; i < m; i++) {
+        memset(lp.tau, 0, m * sizeof(double));
+        lp.tau[i] = row_scale[i];
+        basis_ftran(lp.factor, lp.tau, lp.work);
+        double tol = 0.0;
+        for (int k = 0; k < m; k++) tol = fmax(tol, fabs(lp.tau[k]));
+        tol *= RANGING_TOLERANCE;
+        double rise = INFINITY;
+        double fall = INFINITY;
+        for (int k = 0; k < m; k++) {
+            double x = fmax(lp.x_basic[k], 0.0);
+            if (lp.tau[k] < -tol) rise = fmin(rise, x / -lp.tau[k]);
+            if (lp.tau[k] > tol) fall = fmin(fall, x / lp.tau[k]);
+        }
+        sol->requirement_lower[i] = problem->requirements[i] - fall;
+        sol->requirement_upper[i] = problem->requirements[i] + rise;
+    }
+    
+    /* y = R B'^-T C c_B, and row p of B^-1 is c_p (row p of B'^-1) R, stored transposed. */
+    for (int r = 0; r < m; r++) {
+        lp.y[r] = revised_cost(&lp, lp.basis[r], 2) * col_scale[r];
+    }
+    basis_btran(lp.factor, lp.y, lp.work);
+    for (int i = 0; i < m; i++) {
+        lp.y[i] *= row_scale[i];
+    }
+    int count = 0;
+    for (int r = 0; r < m; r++) {
+        if (lp.basis[r] < n) count++;
+    }
+    for (int r = 0, p = 0; r < m; r++) {
+        if (lp.basis[r] >= n) continue;
+        memset(lp.rho, 0, m * sizeof(double));
+        lp.rho[r] = col_scale[r];
+        basis_btran(lp.factor, lp.rho, lp.work);
+        for (int i = 0; i < m; i++) {
+            rows[(size_t)i * count + p] = lp.rho[i] * row_scale[i];
+        }
+        up[p] = down[p] = INFINITY;
+        foods[p++] = lp.basis[r];
+    }
+    for (int col = 0; col < n + m; col++) {
+        if (basis_pos[col]) continue;
+        double d = fmax(revised_reduced_cost(&lp, col, 2), 0.0);
+        if (col < n) {
+            sol->cost_lower[col] = problem->costs[col] - d;
+            sol->cost_upper[col] = INFINITY;
+        }
+        revised_dot_rows(&lp, col, rows, count, lp.tau);
+        for (int p = 0; p < count; p++) {
+            double alpha = lp.tau[p];
+            if (alpha > EPSILON) up[p] = fmin(up[p], d / alpha);
+            if (alpha < -EPSILON) down[p] = fmin(down[p], d / -alpha);
+        }
+    }
+    for (int p = 0; p < count; p++) {
+        sol->cost_lower[foods[p]] = problem->costs[foods[p]] - down[p];
+        sol->cost_upper[foods[p]] = problem->costs[foods[p]] + up[p];
+    }
+}
+
+/*
+ * Opens a solve's stats; until stats_end, total_ns and total_cycles hold the
+ * clocks at the start. stats_end converts every phase's cycles to ns with the
+ * solve's measured cycles per ns and hands the stats to `sol`.
+ */
+static void stats_begin(SolveStats* stats) {
+#if SIMPLEX_STATS
+    memset(stats, 0, sizeof(SolveStats));
+    stats->total_ns = monotonic_ns();
+    stats->total_cycles = stats_clock();
+#else
+    (void)stats;
+#endif
+}
+
+static void stats_end(SolveStats* stats, Solution* sol) {
+#if SIMPLEX_STATS
+    stats->total_cycles = stats_clock() - stats->total_cycles;
+    stats->total_ns = monotonic_ns() - stats->total_ns;
+    double ns_per_cycle = stats->total_cycles > 0 ? (double)stats->total_ns / stats->total_cycles : 0.0;
+    for (int p = 0; p < NUM_SOLVE_PHASES; p++) {
+        stats->ns[p] = (long long)(stats->cycles[p] * ns_per_cycle);
+    }
+    stats->pivots = sol->iterations;
+    stats->degenerate_pivots = sol->degenerate_pivots;
+    sol->stats = *stats;
+#else
+    (void)stats;
+    (void)sol;
+#endif
+}
+
+/*
+ * simplex_solve on a caller-owned workspace, for hot loops: everything the
+ * solve needs, the returned Solution included, comes from the workspace
+ * arena. The Solution belongs to the workspace and is overwritten by its next
+ * solve; do not free it. Any problem size works, and once the workspace has
+ * seen a size, solving that size again takes nothing from the heap. NULL if
+ * the engine failed.
+ */
+Solution* simplex_solve_in(SolverWorkspace* ws, const DietProblem* problem, const SolverOptions* opts) {
+    SolverOptions defaults = solver_options_default();
+    if (!opts) opts = &defaults;
+    arena_reset(&ws->arena);
+    stats_begin(&ws->stats);
+    
+    Solution* sol = arena_solution(&ws->arena, problem->num_foods, problem->num_nutrients);
+    if (!sol) return NULL;
+    int failed = opts->presolve && !opts->warm_basis ? presolve_and_solve(problem, ws, opts, sol)
+                                                     : solve_scaled(problem, ws, opts, sol);
+    if (failed) return NULL;
+    long long clock = STATS_CLOCK();
+    compute_ranging(problem, ws, opts, sol);
+    STATS_LAP(&ws->stats, PHASE_RANGING, clock,
+              opts->ranging ? (long long)problem->num_nutrients * matrix_bytes(problem) : 0);
+    stats_end(&ws->stats, sol);
+    return sol;
+}
+
+/*
+ * A one-off solve: builds a workspace, solves in it and returns a heap copy
+ * of the Solution for free_solution, so every call allocates. Callers that
+ * solve repeatedly should keep a workspace and use simplex_solve_in, which
+ * takes nothing from the heap once warm. NULL if the engine failed or memory
+ * ran out.
+ */
+Solution* simplex_solve(const DietProblem* problem, const SolverOptions* opts) {
+    SolverWorkspace* ws = create_workspace(problem->num_foods, problem->num_nutrients);
+    if (!ws) return NULL;
+    Solution* sol = simplex_solve_in(ws, problem, opts);
+    if (sol) sol = copy_solution(sol, problem->num_foods, problem->num_nutrients);
+    free_workspace(ws);
+    return sol;
+}
+
+/*
+ * Batch solving: one catalogue, many requirement vectors. Every worker owns a
+ * contiguous range of problems and a workspace reused for all of them; a
+ * worker that drains its range steals chunks from the others' ranges.
+ */
+#define BATCH_CHUNK 8
+
+typedef struct {
+    atomic_int next;
+    int end;
+    char pad[TABLEAU_ALIGNMENT - sizeof(atomic_int) - sizeof(int)];
+} BatchRange;
+
+typedef struct {
+    const DietProblem* catalogue;
+    const double* requirements;
+    BatchSolution* out;
+    SolverOptions opts;
+    const Scaling* scaling;
+    BatchRange* ranges;
+    int num_workers;
+} BatchJob;
+
+typedef struct {
+    BatchJob* job;
+    int index;
+    SolverWorkspace* ws;
+    double* rhs;
+} BatchWorker;
+
+/* rhs holds num_nutrients doubles for the scaled requirements. */
+static void batch_solve_one(BatchJob* job, SolverWorkspace* ws, double* rhs, int k) {
+    BatchSolution* out = job->out;
+    int n = out->num_foods;
+    int m = out->num_nutrients;
+    arena_reset(&ws->arena);
+    stats_begin(&ws->stats);
+    Solution view = { 0 };
+    view.amounts = out->amounts + (size_t)k * n;
+    view.shadow_prices = out->shadow_prices + (size_t)k * m;
+    view.feasible = 1;
+    
+    const double* requirements = job->requirements + (size_t)k * m;
+    if (job->scaling) {
+        scale_requirements(job->scaling, requirements, rhs);
+        requirements = rhs;
+    }
+    
+    if (solve_into(job->catalogue, requirements, ws, &job->opts, &view) != 0) {
+        reset_solution(&view, n, m);
+        out->total_costs[k] = 0.0;
+        out->status[k] = SOLVE_NUMERICAL_ERROR;
+        return;
+    }
+    if (job->scaling) unscale_solution(job->scaling, &view);
+    out->total_costs[k] = view.total_cost;
+    out->status[k] = view.status;
+}
+
+static void* batch_worker_main(void* arg) {
+    BatchWorker* worker = (BatchWorker*)arg;
+    BatchJob* job = worker->job;
+    for (int v = 0; v < job->num_workers; v++) {
+        BatchRange* range = &job->ranges[(worker->index + v) % job->num_workers];
+        for (;;) {
+            int first = atomic_fetch_add(&range->next, BATCH_CHUNK);
+            if (first >= range->end) break;
+            int last = first + BATCH_CHUNK < range->end ? first + BATCH_CHUNK : range->end;
+            for (int k = first; k < last; k++) {
+                batch_solve_one(job, worker->ws, worker->rhs, k);
+            }
+        }
+    }
+    return NULL;
+}
+
+static void free_batch_workers(BatchWorker* workers, int num_workers) {
+    for (int w = 0; w < num_workers; w++) {
+        free_workspace(workers[w].ws);
+        free(workers[w].rhs);
+    }
+    free(workers);
+}
+
+void free_batch_solution(BatchSolution* batch) {
+    free(batch->amounts);
+    free(batch->shadow_prices);
+    free(batch->total_costs);
+    free(batch->status);
+    free(batch);
+}
+
+/*
+ * Solves `num_problems` diet problems that share `catalogue` and differ only
+ * in their requirements (`requirements` is num_problems x num_nutrients,
+ * row-major). opts->num_threads sets the number of batch workers; each
+ * individual solve runs single-threaded. opts defaults as for simplex_solve,
+ * but presolve is ignored: every problem is solved against the one shared
+ * catalogue. NULL if the results, the scaling opts->scaling asks for or a
+ * worker's workspace cannot be allocated; a worker thread that fails to
+ * start leaves its range to be stolen by the others.
+ */
+BatchSolution* simplex_solve_batch(const DietProblem* catalogue, const double* requirements, int num_problems,
+                                   const SolverOptions* opts) {
+    int n = catalogue->num_foods;
+    int m = catalogue->num_nutrients;
+    
+    BatchSolution* out = (BatchSolution*)calloc(1, sizeof(BatchSolution));
+    if (!out) return NULL;
+    out->num_problems = num_problems;
+    out->num_foods = n;
+    out->num_nutrients = m;
+    out->amounts = (double*)malloc((size_t)num_problems * n * sizeof(double));
+    out->shadow_prices = (double*)malloc((size_t)num_problems * m * sizeof(double));
+    out->total_costs = (double*)malloc(num_problems * sizeof(double));
+    out->status = (int*)malloc(num_problems * sizeof(int));
+    if (!out->amounts || !out->shadow_prices || !out->total_costs || !out->status) {
+        free_batch_solution(out);
+        return NULL;
+    }
+    
+    BatchJob job;
+    job.catalogue = catalogue;
+    job.requirements = requirements;
+    job.out = out;
+    job.opts = opts ? *opts : solver_options_default();
+    job.num_workers = job.opts.num_threads > 1 ? job.opts.num_threads : 1;
+    job.opts.num_threads = 1;
+    job.opts.verbose = 0;
+    job.opts.trace = NULL;
+    /* Requirements only touch the right-hand side, so one scaling serves every problem. */
+    Arena arena = { 0 };
+    Scaling* scaling = job.opts.scaling ? create_scaling(&arena, catalogue) : NULL;
+    job.scaling = scaling;
+    if (scaling) job.catalogue = scaling->scaled;
+    
+    job.ranges = (BatchRange*)aligned_alloc(TABLEAU_ALIGNMENT, job.num_workers * sizeof(BatchRange));
+    pthread_t* threads = (pthread_t*)malloc(job.num_workers * sizeof(pthread_t));
+    int* started = (int*)calloc(job.num_workers, sizeof(int));
+    BatchWorker* workers = (BatchWorker*)calloc(job.num_workers, sizeof(BatchWorker));
+    int failed = (job.opts.scaling && !scaling) || !job.ranges || !threads || !started || !workers;
+    for (int w = 0; w < job.num_workers && !failed; w++) {
+        atomic_init(&job.ranges[w].next, (int)((long)num_problems * w / job.num_workers));
+        job.ranges[w].end = (int)((long)num_problems * (w + 1) / job.num_workers);
+        workers[w].job = &job;
+        workers[w].index = w;
+        workers[w].ws = create_workspace(n, m);
+        workers[w].rhs = (double*)malloc(m * sizeof(double));
+        failed = !workers[w].ws || !workers[w].rhs;
+    }
+    if (failed) {
+        if (workers) free_batch_workers(workers, job.num_workers);
+        free(started);
+        free(threads);
+        free(job.ranges);
+        free_arena(&arena);
+        free_batch_solution(out);
+        return NULL;
+    }
+    
+    for (int w = 1; w < job.num_workers; w++) {
+        started[w] = pthread_create(&threads[w], NULL, batch_worker_main, &workers[w]) == 0;
+    }
+    batch_worker_main(&workers[0]);
+    for (int w = 1; w < job.num_workers; w++) {
+        if (started[w]) pthread_join(threads[w], NULL);
+    }
+    
+    free_batch_workers(workers, job.num_workers);
+    free(started);
+    free(threads);
+    free(job.ranges);
+    free_arena(&arena);
+    return out;
+}
+
+/*
+ * Parametric analysis. From an optimal basis, one requirement b_i or one
+ * price c_j is moved as a parameter and the optimal cost traced in each
+ * direction. The basis stays optimal until a basic amount (for b_i) or a
+ * nonbasic reduced cost (for c_j) reaches zero. That is a breakpoint: one
+ * dual or primal simplex pivot gives the basis for the next segment, and the
+ * trace carries on from there. The whole curve costs one pivot per
+ * breakpoint on a single factorization instead of a solve per sample.
+ */
+#define PARAMETRIC_MAX_PIVOTS 1000
+
+typedef struct {
+    int count;
+    int capacity;
+    double* values;
+    double* costs;
+    double* slopes;     /* slope of the segment that ends at each point */
+    int failed;         /* a point was dropped for want of memory */
+} CurvePoints;
+
+static void curve_push(CurvePoints* c, double value, double cost, double slope) {
+    if (c->count == c->capacity) {
+        int capacity = c->capacity ? 2 * c->capacity : 16;
+        double* values = (double*)realloc(c->values, capacity * sizeof(double));
+        if (values) c->values = values;
+        double* costs = (double*)realloc(c->costs, capacity * sizeof(double));
+        if (costs) c->costs = costs;
+        double* slopes = (double*)realloc(c->slopes, capacity * sizeof(double));
+        if (slopes) c->slopes = slopes;
+        if (!values || !costs || !slopes) {
+            c->failed = 1;
+            return;
+        }
+        c->capacity = capacity;
+    }
+    c->values[c->count] = value;
+    c->costs[c->count] = cost;
+    c->slopes[c->count] = slope;
+    c->count++;
+}
+
+static void free_curve_points(CurvePoints* c) {
+    free(c->values);
+    free(c->costs);
+    free(c->slopes);
+}
+
+static int revised_swap(RevisedLP* lp, int* basis_pos, int r, int q) {
+    revised_column(lp, q, lp->column);
+    basis_ftran(lp->factor, lp->column, lp->work);
+    basis_pos[lp->basis[r]] = 0;
+    basis_pos[q] = r + 1;
+    return revised_pivot(lp, r, q);
+}
+
+/*
+ * Moves b_i (held in b, which lp->requirements points at) in direction s = +1
+ * or -1 until `limit`, pushing a point at every breakpoint and at the end.
+ * *range gets the value where the starting basis stops being optimal.
+ */
+static CurveEnd trace_requirement(RevisedLP* lp, int* basis_pos, double* b, int i, int s, double limit,
+                                  CurvePoints* out, double* range) {
+    int m = lp->m;
+    *range = s * INFINITY;
+    for (int pivots = 0; pivots < PARAMETRIC_MAX_PIVOTS; pivots++) {
+        revised_duals(lp, 2);
+        double slope = lp->y[i];
+        
+        /* x_B moves along s * B^-1 e_i; the first basic amount to reach zero blocks. */
+        memset(lp->tau, 0, m * sizeof(double));
+        lp->tau[i] = 1.0;
+        basis_ftran(lp->factor, lp->tau, lp->work);
+        double block = INFINITY;
+        int r = -1;
+        for (int k = 0; k < m; k++) {
+            double rate = s * lp->tau[k];
+            if (rate >= -EPSILON) continue;
+            double step = fmax(lp->x_basic[k], 0.0) / -rate;
+            if (step < block) {
+                block = step;
+                r = k;
+            }
+        }
+        if (pivots == 0 && r >= 0) *range = b[i] + s * block;
+        
+        double step = fmin(block, fabs(limit - b[i]));
+        for (int k = 0; k < m; k++) {
+            lp->x_basic[k] += s * step * lp->tau[k];
+        }
+        b[i] = step < block ? limit : b[i] + s * step;
+        if (step > 0.0) curve_push(out, b[i], revised_objective(lp), slope);
+        if (step < block || r < 0) return CURVE_LIMIT;
+        
+        /* Dual ratio test on row r: the entering column must lift x_r back up. */
+        lp->x_basic[r] = 0.0;
+        memset(lp->rho, 0, m * sizeof(double));
+        lp->rho[r] = 1.0;
+        basis_btran(lp->factor, lp->rho, lp->work);
+        int q = -1;
+        double best = INFINITY;
+        for (int col = 0; col < lp->n + m; col++) {
+            if (basis_pos[col]) continue;
+            double alpha = revised_dot(lp, col, lp->rho);
+            if (alpha >= -EPSILON) continue;
+            double ratio = fmax(revised_reduced_cost(lp, col, 2), 0.0) / -alpha;
+            if (ratio < best) {
+                best = ratio;
+                q = col;
+            }
+        }
+        if (q < 0) return CURVE_INFEASIBLE;
+        if (!revised_swap(lp, basis_pos, r, q)) return CURVE_PIVOT_LIMIT;
+    }
+    return CURVE_PIVOT_LIMIT;
+}
+
+/* As trace_requirement, for the price c_j held in the costs array the problem copy owns. */
+static CurveEnd trace_price(RevisedLP* lp, int* basis_pos, double* costs, int j, int s, double limit,
+                            CurvePoints* out, double* range) {
+    int m = lp->m;
+    *range = s * INFINITY;
+    for (int pivots = 0; pivots < PARAMETRIC_MAX_PIVOTS; pivots++) {
+        revised_duals(lp, 2);
+        int p = basis_pos[j] - 1;
+        double slope = p >= 0 ? lp->x_basic[p] : 0.0;
+        
+        /* d_k changes at rate [k == j] - (B^-1 a_k)_p; the first to reach zero blocks. */
+        if (p >= 0) {
+            memset(lp->rho, 0, m * sizeof(double));
+            lp->rho[p] = 1.0;
+            basis_btran(lp->factor, lp->rho, lp->work);
+        }
+        double block = INFINITY;
+        int q = -1;
+        for (int col = 0; col < lp->n + m; col++) {
+            if (basis_pos[col]) continue;
+            double rate = s * ((col == j) - (p >= 0 ? revised_dot(lp, col, lp->rho) : 0.0));
+            if (rate >= -EPSILON) continue;
+            double step = fmax(revised_reduced_cost(lp, col, 2), 0.0) / -rate;
+            if (step < block) {
+                block = step;
+                q = col;
+            }
+        }
+        if (pivots == 0 && q >= 0) *range = costs[j] + s * block;
+        
+        double step = fmin(block, fabs(limit - costs[j]));
+        costs[j] = step < block ? limit : costs[j] + s * step;
+        if (step > 0.0) curve_push(out, costs[j], revised_objective(lp), slope);
+        if (step < block || q < 0) return CURVE_LIMIT;
+        
+        /* Primal ratio test for the column whose reduced cost hit zero. */
+        revised_column(lp, q, lp->column);
+        basis_ftran(lp->factor, lp->column, lp->work);
+        int r = -1;
+        double best = INFINITY;
+        for (int k = 0; k < m; k++) {
+            if (lp->column[k] <= EPSILON) continue;
+            double ratio = fmax(lp->x_basic[k], 0.0) / lp->column[k];
+            if (ratio < best) {
+                best = ratio;
+                r = k;
+            }
+        }
+        if (r < 0) return CURVE_UNBOUNDED;
+        basis_pos[lp->basis[r]] = 0;
+        basis_pos[q] = r + 1;
+        if (!revised_pivot(lp, r, q)) return CURVE_PIVOT_LIMIT;
+    }
+    return CURVE_PIVOT_LIMIT;
+}
+
+void free_cost_curve(CostCurve* curve) {
+    free(curve->values);
+    free(curve->costs);
+    free(curve->slopes);
+    free(curve);
+}
+
+/* Traces both directions from sol's basis; exactly one of nutrient and food is >= 0. */
+static CostCurve* cost_curve(const DietProblem* problem, const Solution* sol, int nutrient, int food,
+                             double lower, double upper) {
+    int n = problem->num_foods;
+    int m = problem->num_nutrients;
+    if (!sol || !sol->basis || sol->status != SOLVE_OPTIMAL || !sol->feasible || lower > upper) return NULL;
+    
+    /* The trace runs on the scaled problem, whose parameter is `scale` times the caller's. */
+    SolverWorkspace* ws = create_workspace(n, m);
+    Scaling* sc = ws ? create_scaling(&ws->arena, problem) : NULL;
+    if (!sc || prepare_workspace(ws, n, m) != 0) {
+        if (ws) free_workspace(ws);
+        return NULL;
+    }
+    DietProblem* copy = sc->scaled;
+    double scale = nutrient >= 0 ? sc->row_scale[nutrient] : sc->col_scale[food];
+    double* parameter = nutrient >= 0 ? &copy->requirements[nutrient] : &copy->costs[food];
+    double start = *parameter;
+    lower *= scale;
+    upper *= scale;
+    RevisedLP lp;
+    revised_attach(&lp, copy, copy->requirements, ws);
+    
+    CurvePoints below = { 0 };
+    CurvePoints above = { 0 };
+    CostCurve* curve = NULL;
+    double range[2];
+    CurveEnd ends[2];
+    for (int side = 0; side < 2; side++) {
+        int s = side ? 1 : -1;
+        double limit = side ? fmax(upper, start) : fmin(lower, start);
+        *parameter = start;
+        memset(ws->basis_pos, 0, (n + 2 * m) * sizeof(int));
+        lp.factor->num_etas = 0;
+        if (!revised_load_basis(&lp, sol->basis, ws->basis_pos)) goto done;
+        if (side == 0) curve_push(&below, start, revised_objective(&lp), 0.0);
+        ends[side] = nutrient >= 0
+                   ? trace_requirement(&lp, ws->basis_pos, copy->requirements, nutrient, s, limit,
+                                       side ? &above : &below, &range[side])
+                   : trace_price(&lp, ws->basis_pos, copy->costs, food, s, limit,
+                                 side ? &above : &below, &range[side]);
+    }
+    
+    if (below.failed || above.failed) goto done;
+    
+    /* below runs from the start downwards, with slopes on the segments leading away from it. */
+    curve = (CostCurve*)malloc(sizeof(CostCurve));
+    if (!curve) goto done;
+    curve->num_points = below.count + above.count;
+    curve->values = (double*)malloc(curve->num_points * sizeof(double));
+    curve->costs = (double*)malloc(curve->num_points * sizeof(double));
+    curve->slopes = (double*)malloc(curve->num_points * sizeof(double));
+    if (!curve->values || !curve->costs || !curve->slopes) {
+        free_cost_curve(curve);
+        curve = NULL;
+        goto done;
+    }
+    int k = 0;
+    for (int e = below.count - 1; e >= 0; e--, k++) {
+        curve->values[k] = below.values[e] / scale;
+        curve->costs[k] = below.costs[e];
+        curve->slopes[k] = e > 0 ? below.slopes[e] * scale : 0.0;
+    }
+    for (int e = 0; e < above.count; e++, k++) {
+        curve->values[k] = above.values[e] / scale;
+        curve->costs[k] = above.costs[e];
+        curve->slopes[k - 1] = above.slopes[e] * scale;
+    }
+    curve->slopes[curve->num_points - 1] = 0.0;
+    curve->basis_lower = range[0] / scale;
+    curve->basis_upper = range[1] / scale;
+    curve->lower_end = ends[0];
+    curve->upper_end = ends[1];
+    
+done:
+    free_curve_points(&below);
+    free_curve_points(&above);
+    free_workspace(ws);
+    return curve;
+}
+
+/* Optimal cost as the requirement of `nutrient` moves over [lower, upper], from sol's optimal basis. */
+CostCurve* requirement_cost_curve(const DietProblem* problem, const Solution* sol, int nutrient, double lower,
+                                  double upper) {
+    return cost_curve(problem, sol, nutrient, -1, lower, upper);
+}
+
+/* Optimal cost as the price of `food` moves over [lower, upper], from sol's optimal basis. */
+CostCurve* price_cost_curve(const DietProblem* problem, const Solution* sol, int food, double lower,
+                            double upper) {
+    return cost_curve(problem, sol, -1, food, lower, upper);
+}
+
+static const char* solve_phase_names[NUM_SOLVE_PHASES] = {
+    "presolve", "scaling", "build", "pricing", "ratio_test", "pivot", "extraction", "postsolve", "ranging"
+};
+
+/* Writes `stats` as one JSON object. */
+void write_solve_stats_json(FILE* out, const SolveStats* stats) {
+    fprintf(out, "{\"total_ns\": %lld, \"total_cycles\": %lld, \"pivots\": %d, \"degenerate_pivots\": %d, "
+            "\"phases\": {", stats->total_ns, stats->total_cycles, stats->pivots, stats->degenerate_pivots);
+    for (int p = 0; p < NUM_SOLVE_PHASES; p++) {
+        fprintf(out, "%s\"%s\": {\"ns\": %lld, \"cycles\": %lld, \"calls\": %lld, \"bytes\": %lld}",
+                p ? ", " : "", solve_phase_names[p], stats->ns[p], stats->cycles[p], stats->calls[p],
+                stats->bytes[p]);
+    }
+    fprintf(out, "}}\n");
+}
+
+void print_solution(Solution* sol, const DietProblem* problem) {
+    if (!sol || !sol->feasible) {
+        printf("\nNo feasible solution found!\n");
+        if (sol && (sol->status == SOLVE_ITERATION_LIMIT || sol->status == SOLVE_TIME_LIMIT) &&
+            isfinite(sol->dual_bound)) {
+            printf("Stopped at the %s; the cost is at least $%.2f\n",
+                   solve_status_name(sol->status), sol->dual_bound);
+        }
+        return;
+    }
+    
+    printf("\n");
+    printf("========================================\n");
+    if (sol->status == SOLVE_OPTIMAL) {
+        printf("      OPTIMAL DIET SOLUTION\n");
+    } else {
+        printf("      BEST DIET FOUND (%s)\n", solve_status_name(sol->status));
+    }
+    printf("========================================\n");
+    printf("\n%s: $%.2f\n", sol->status == SOLVE_OPTIMAL ? "Minimum Daily Cost" : "Daily Cost", sol->total_cost);
+    if (sol->status != SOLVE_OPTIMAL && isfinite(sol->dual_bound)) {
+        printf("Optimal cost lies in [$%.2f, $%.2f]\n", sol->dual_bound, sol->primal_bound);
+    }
+    if (sol->presolve.elapsed_ns > 0) {
+        printf("Presolve removed %d of %d foods and %d of %d nutrients\n",
+               problem->num_foods - sol->presolve.num_foods, problem->num_foods,
+               problem->num_nutrients - sol->presolve.num_nutrients, problem->num_nutrients);
+    }
+    if (sol->scaling.elapsed_ns > 0) {
+        printf("Scaling narrowed the nutrient range from %.1e to %.1e\n",
+               sol->scaling.range_before, sol->scaling.range_after);
+    }
+    printf("\nFood Quantities:\n");
+    printf("----------------------------------------\n");
+    
+    for (int i = 0; i < problem->num_foods; i++) {
+        if (sol->amounts[i] > EPSILON) {
+            printf("%-20s: %8.2f units ($%.2f)\n", 
+                   food_name(problem, i), 
+                   sol->amounts[i], 
+                   sol->amounts[i] * problem->costs[i]);
+        }
+    }
+    
+    printf("\n========================================\n");
+    printf("      SHADOW PRICES (Dual Values)\n");
+    printf("========================================\n");
+    printf("\nMarginal value of each constraint:\n");
+    printf("----------------------------------------\n");
+    
+    for (int i = 0; i < problem->num_nutrients; i++) {
+        printf("%-20s: $%.6f per unit\n", 
+               nutrient_name(problem, i), 
+               sol->shadow_prices[i]);
+    }
+    printf("\n");
+}
+
+static void print_cost_curve(const CostCurve* curve, const char* slope_label) {
+    printf("   Value   | Daily Cost | %s\n", slope_label);
+    printf("----------------------------------------\n");
+    for (int k = 0; k < curve->num_points; k++) {
+        if (k + 1 < curve->num_points) {
+            printf("%9.2f  | $%8.2f  | %8.4f\n", curve->values[k], curve->costs[k], curve->slopes[k]);
+        } else {
+            printf("%9.2f  | $%8.2f  |\n", curve->values[k], curve->costs[k]);
+        }
+    }
+}
+
+/*
+ * Exact cost curves from the optimal basis: each bought food's price and each
+ * binding requirement from 0 to twice its value, with the range over which
+ * the current plan stays optimal.
+ */
+/* compute_ranging leaves every range NaN unless SolverOptions.ranging was set. */
+static int ranging_computed(const Solution* sol, const DietProblem* problem) {
+    for (int j = 0; j < problem->num_foods; j++) {
+        if (!isnan(sol->cost_lower[j])) return 1;
+    }
+    for (int i = 0; i < problem->num_nutrients; i++) {
+        if (!isnan(sol->requirement_lower[i])) return 1;
+    }
+    return 0;
+}
+
+static void print_ranging(const Solution* sol, const DietProblem* problem) {
+    printf("\nPrice ranging (same diet within the range):\n");
+    printf("%-20s %9s %11s %11s\n", "Food", "Price", "Decrease", "Increase");
+    for (int j = 0; j < problem->num_foods; j++) {
+        if (sol->amounts[j] <= EPSILON) continue;
+        printf("%-20s $%8.2f %11.4f %11.4f\n", food_name(problem, j), problem->costs[j],
+               problem->costs[j] - sol->cost_lower[j], sol->cost_upper[j] - problem->costs[j]);
+    }
+    printf("\nRequirement ranging (same shadow price within the range):\n");
+    printf("%-20s %9s %11s %11s\n", "Nutrient", "Required", "Decrease", "Increase");
+    for (int i = 0; i < problem->num_nutrients; i++) {
+        printf("%-20s %9.1f %11.2f %11.2f\n", nutrient_name(problem, i), problem->requirements[i],
+               problem->requirements[i] - sol->requirement_lower[i],
+               sol->requirement_upper[i] - problem->requirements[i]);
+    }
+}
+
+void sensitivity_analysis(Solution* sol, const DietProblem* problem) {
+    printf("\n========================================\n");
+    printf("      SENSITIVITY ANALYSIS\n");
+    printf("========================================\n");
+    
+    if (ranging_computed(sol, problem)) {
+        print_ranging(sol, problem);
+    } else {
+        printf("\nRanging was not computed (solve with SolverOptions.ranging = 1).\n");
+    }
+    
+    for (int j = 0; j < problem->num_foods; j++) {
+        if (sol->amounts[j] <= EPSILON) continue;
+        double cost = problem->costs[j];
+        CostCurve* curve = price_cost_curve(problem, sol, j, 0.0, 2.0 * cost);
+        if (!curve) continue;
+        printf("\n%s (Current: $%.2f, Quantity: %.2f)\n", food_name(problem, j), cost, sol->amounts[j]);
+        printf("Same diet while the price is in [$%.2f, $%.2f]\n", curve->basis_lower, curve->basis_upper);
+        print_cost_curve(curve, "Quantity");
+        free_cost_curve(curve);
+    }
+    
+    for (int i = 0; i < problem->num_nutrients; i++) {
+        if (sol->shadow_prices[i] <= EPSILON) continue;
+        double required = problem->requirements[i];
+        CostCurve* curve = requirement_cost_curve(problem, sol, i, 0.0, 2.0 * required);
+        if (!curve) continue;
+        printf("\n%s (Required: %.1f, Shadow Price: $%.4f)\n", nutrient_name(problem, i), required,
+               sol->shadow_prices[i]);
+        printf("Same shadow price while the requirement is in [%.2f, %.2f]\n", curve->basis_lower,
+               curve->basis_upper);
+        if (curve->upper_end == CURVE_INFEASIBLE) {
+            printf("No diet meets more than %.2f\n", curve->values[curve->num_points - 1]);
+        }
+        print_cost_curve(curve, "Shadow Price");
+        free_cost_curve(curve);
+    }
+    printf("\n");
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* Reference pointer-per-row layout, kept only so the benchmark can compare against it. */
+typedef struct {
+    double** matrix;
+    int rows;
+    int cols;
+} RowTableau;
+
+static RowTableau* create_row_tableau(int rows, int cols) {
+    RowTableau* t = (RowTableau*)malloc(sizeof(RowTableau));
+    t->rows = rows;
+    t->cols = cols;
+    t->matrix = (double**)malloc(rows * sizeof(double*));
+    for (int i = 0; i < rows; i++) {
+        t->matrix[i] = (double*)calloc(cols, sizeof(double));
+    }
+    return t;
+}
+
+static void free_row_tableau(RowTableau* t) {
+    for (int i = 0; i < t->rows; i++) {
+        free(t->matrix[i]);
+    }
+    free(t->matrix);
+    free(t);
+}
+
+static void row_pivot_operation(RowTableau* t, int pivot_row, int pivot_col) {
+    double pivot_element = t->matrix[pivot_row][pivot_col];
+    
+    for (int j = 0; j < t->cols; j++) {
+        t->matrix[pivot_row][j] /= pivot_element;
+    }
+    
+    for (int i = 0; i < t->rows; i++) {
+        if (i != pivot_row) {
+            double factor = t->matrix[i][pivot_col];
+            for (int j = 0; j < t->cols; j++) {
+                t->matrix[i][j] -= factor * t->matrix[pivot_row][j];
+            }
+        }
+    }
+}
+
+static void fill_bench_tableau(Tableau* t, RowTableau* r, int num_foods, int num_constraints) {
+    unsigned long long seed = 42;
+    for (int i = 0; i < t->rows; i++) {
+        for (int j = 0; j < t->cols; j++) {
+            double v = 0.0;
+            if (i == num_constraints) {
+                v = j < num_foods ? 0.1 + 5.0 * uniform_random(&seed) : 0.0;
+            } else if (j < num_foods) {
+                v = -50.0 * uniform_random(&seed);
+            } else if (j == num_foods + i) {
+                v = -1.0;
+            } else if (j == t->cols - 1) {
+                v = -100.0 * uniform_random(&seed);
+            }
+            TABLEAU_AT(t, i, j) = v;
+            r->matrix[i][j] = v;
+        }
+    }
+}
+
+static int bench_pivot_col(const double* row, int num_foods) {
+    int best = 0;
+    for (int j = 1; j < num_foods; j++) {
+        if (fabs(row[j]) > fabs(row[best])) best = j;
+    }
+    return best;
+}
+
+static void bench_layout(int num_foods, int num_constraints, int pivots) {
+    int rows = num_constraints + 1;
+    int cols = num_foods + num_constraints + 1;
+    Tableau* t = create_tableau(rows, cols);
+    RowTableau* r = create_row_tableau(rows, cols);
+    double row_time = INFINITY;
+    double flat_time = INFINITY;
+    
+    set_tableau_kernel(t, KERNEL_SCALAR);
+    for (int rep = 0; rep < 5; rep++) {
+        fill_bench_tableau(t, r, num_foods, num_constraints);
+        
+        double start = now_seconds();
+        for (int k = 0; k < pivots; k++) {
+            int row = k % num_constraints;
+            row_pivot_operation(r, row, bench_pivot_col(r->matrix[row], num_foods));
+        }
+        row_time = fmin(row_time, now_seconds() - start);
+        
+        start = now_seconds();
+        for (int k = 0; k < pivots; k++) {
+            int row = k % num_constraints;
+            pivot_operation(t, row, bench_pivot_col(tableau_row(t, row), num_foods));
+        }
+        flat_time = fmin(flat_time, now_seconds() - start);
+    }
+    
+    printf("%6d x %-4d | %-10s | %6d | %12.1f | %d\n",
+           num_foods, num_constraints, "row ptrs", pivots, row_time * 1e9 / pivots, rows + 3);
+    printf("%6d x %-4d | %-10s | %6d | %12.1f | %d  (%.2fx)\n",
+           num_foods, num_constraints, "contiguous", pivots, flat_time * 1e9 / pivots, 1,
+           row_time / flat_time);
+    
+    free_row_tableau(r);
+    free_tableau(t);
+}
+
+static void bench_threads(int num_foods, int num_constraints, int pivots) {
+    int rows = num_constraints + 1;
+    int cols = num_foods + num_constraints + 1;
+    Tableau* t = create_tableau(rows, cols);
+    RowTableau* r = create_row_tableau(rows, cols);
+    double serial_time = 0.0;
+    
+    for (int threads = 1; threads <= 32; threads *= 2) {
+        PivotPool* pool = create_pivot_pool(threads);
+        double best = INFINITY;
+        for (int rep = 0; rep < 3; rep++) {
+            fill_bench_tableau(t, r, num_foods, num_constraints);
+            double start = now_seconds();
+            for (int k = 0; k < pivots; k++) {
+                int row = k % num_constraints;
+                parallel_pivot_operation(pool, t, row, bench_pivot_col(tableau_row(t, row), num_foods));
+            }
+            best = fmin(best, now_seconds() - start);
+        }
+        free_pivot_pool(pool);
+        if (threads == 1) serial_time = best;
+        printf("%6d x %-4d | %7d | %12.1f | %.2fx\n",
+               num_foods, num_constraints, threads, best * 1e9 / pivots, serial_time / best);
+    }
+    
+    free_row_tableau(r);
+    free_tableau(t);
+}
+
+static void bench_kernels(int num_foods, int num_constraints, int pivots) {
+    int rows = num_constraints + 1;
+    int cols = num_foods + num_constraints + 1;
+    Tableau* t = create_tableau(rows, cols);
+    RowTableau* r = create_row_tableau(rows, cols);
+    double scalar_time = 0.0;
+    
+    for (int level = KERNEL_SCALAR; level < NUM_KERNELS; level++) {
+        if (!set_tableau_kernel(t, (KernelLevel)level)) continue;
+        double best = INFINITY;
+        for (int rep = 0; rep < 3; rep++) {
+            fill_bench_tableau(t, r, num_foods, num_constraints);
+            double start = now_seconds();
+            for (int k = 0; k < pivots; k++) {
+                int row = k % num_constraints;
+                pivot_operation(t, row, bench_pivot_col(tableau_row(t, row), num_foods));
+            }
+            best = fmin(best, now_seconds() - start);
+        }
+        if (level == KERNEL_SCALAR) scalar_time = best;
+        double flops = 2.0 * (rows - 1) * cols * pivots;
+        printf("%6d x %-4d | %-8s | %12.1f | %7.2f | %.2fx\n",
+               num_foods, num_constraints, kernel_names[level], best * 1e9 / pivots,
+               flops / best * 1e-9, scalar_time / best);
+    }
+    
+    free_row_tableau(r);
+    free_tableau(t);
+}
+
+/*
+ * Synthetic catalogue with realistic sparsity: each food carries each
+ * nutrient with probability `density`, and nutrient magnitudes span four
+ * decades (mg through kcal). Food j always carries nutrient j % m so every
+ * food and every requirement is covered. Built directly in CSC form; NULL
+ * if out of memory.
+ */
+DietProblem* generate_catalogue(int num_foods, int num_nutrients, double density, unsigned long long seed) {
+    double* scale = (double*)malloc(num_nutrients * sizeof(double));
+    if (!scale) return NULL;
+    unsigned long long state = seed;
+    for (int i = 0; i < num_nutrients; i++) {
+        scale[i] = pow(10.0, -1.0 + 4.0 * uniform_random(&state));
+    }
+    unsigned long long pattern_seed = state;
+    
+    int nnz = 0;
+    for (int j = 0; j < num_foods; j++) {
+        for (int i = 0; i < num_nutrients; i++) {
+            double draw = uniform_random(&state);
+            uniform_random(&state);
+            if (draw < density || i == j % num_nutrients) nnz++;
+        }
+        uniform_random(&state);
+    }
+    
+    DietProblem* p = create_sparse_diet_problem(num_foods, num_nutrients, nnz);
+    if (!p) {
+        free(scale);
+        return NULL;
+    }
+    state = pattern_seed;
+    int k = 0;
+    for (int j = 0; j < num_foods; j++) {
+        p->col_start[j] = k;
+        for (int i = 0; i < num_nutrients; i++) {
+            double draw = uniform_random(&state);
+            double value = scale[i] * (0.05 + uniform_random(&state));
+            if (draw < density || i == j % num_nutrients) {
+                p->row_index[k] = i;
+                p->values[k++] = value;
+            }
+        }
+        p->costs[j] = 0.1 + 4.9 * uniform_random(&state);
+    }
+    p->col_start[num_foods] = k;
+    
+    for (int i = 0; i < num_nutrients; i++) {
+        p->requirements[i] = scale[i] * (2.0 + 4.0 * uniform_random(&state));
+    }
+    free(scale);
+    return p;
+}
+
+static void bench_sparse(int num_foods, int num_nutrients, double density) {
+    DietProblem* sparse = generate_catalogue(num_foods, num_nutrients, density, 7);
+    DietProblem* dense = copy_diet_problem(sparse, 0);
+    SolverOptions opts = solver_options_default();
+    opts.engine = ENGINE_REVISED;
+    opts.presolve = 0;
+    opts.scaling = 0;
+    DietProblem* problems[2] = { dense, sparse };
+    double best[2] = { INFINITY, INFINITY };
+    double cost[2] = { 0.0, 0.0 };
+    
+    for (int rep = 0; rep < 3; rep++) {
+        for (int k = 0; k < 2; k++) {
+            double start = now_seconds();
+            Solution* sol = simplex_solve(problems[k], &opts);
+            best[k] = fmin(best[k], now_seconds() - start);
+            cost[k] = sol ? sol->total_cost : NAN;
+            if (sol) free_solution(sol);
+        }
+    }
+    
+    for (int k = 0; k < 2; k++) {
+        printf("%6d x %-4d | %4.0f%% | %-6s | %10.1f KB | %10.3f ms | $%.4f\n",
+               num_foods, num_nutrients, density * 100.0, k ? "CSC" : "dense",
+               matrix_bytes(problems[k]) / 1024.0, best[k] * 1e3, cost[k]);
+    }
+    
+    free_diet_problem(dense);
+    free_diet_problem(sparse);
+}
+
+static void bench_batch(int num_foods, int num_nutrients, int num_problems) {
+    DietProblem* catalogue = generate_catalogue(num_foods, num_nutrients, 0.3, 11);
+    double* rhs = (double*)malloc((size_t)num_problems * num_nutrients * sizeof(double));
+    unsigned long long seed = 5;
+    for (int k = 0; k < num_problems; k++) {
+        for (int i = 0; i < num_nutrients; i++) {
+            rhs[(size_t)k * num_nutrients + i] = catalogue->requirements[i] * (0.8 + 0.4 * uniform_random(&seed));
+        }
+    }
+    
+    SolverOptions opts = solver_options_default();
+    opts.engine = ENGINE_REVISED;
+    opts.presolve = 0;
+    opts.scaling = 0;
+    DietProblem* single = copy_diet_problem(catalogue, 1);
+    double start = now_seconds();
+    for (int k = 0; k < num_problems; k++) {
+        memcpy(single->requirements, rhs + (size_t)k * num_nutrients, num_nutrients * sizeof(double));
+        Solution* sol = simplex_solve(single, &opts);
+        if (sol) free_solution(sol);
+    }
+    double loop_time = now_seconds() - start;
+    printf("%6d x %-4d | %6d | %-12s | %10.2f us\n",
+           num_foods, num_nutrients, num_problems, "solve loop", loop_time * 1e6 / num_problems);
+    
+    for (int threads = 1; threads <= 8; threads *= 2) {
+        opts.num_threads = threads;
+        start = now_seconds();
+        BatchSolution* batch = simplex_solve_batch(catalogue, rhs, num_problems, &opts);
+        double batch_time = now_seconds() - start;
+        if (!batch) continue;
+        char label[32];
+        snprintf(label, sizeof(label), "batch x%d", threads);
+        printf("%6d x %-4d | %6d | %-12s | %10.2f us  (%.2fx)\n",
+               num_foods, num_nutrients, num_problems, label, batch_time * 1e6 / num_problems,
+               loop_time / batch_time);
+        free_batch_solution(batch);
+    }
+    
+    free_diet_problem(single);
+    free_diet_problem(catalogue);
+    free(rhs);
+}
+
+/* simplex_solve against simplex_solve_in on one workspace, with the default pipeline. */
+static void bench_workspace(int num_foods, int num_nutrients, int num_solves) {
+    DietProblem* problem = generate_catalogue(num_foods, num_nutrients, 0.3, 13);
+    SolverOptions opts = solver_options_default();
+    
+    double start = now_seconds();
+    for (int k = 0; k < num_solves; k++) {
+        Solution* sol = simplex_solve(problem, &opts);
+        if (sol) free_solution(sol);
+    }
+    double fresh_time = now_seconds() - start;
+    
+    SolverWorkspace* ws = create_workspace(num_foods, num_nutrients);
+    simplex_solve_in(ws, problem, &opts);
+    simplex_solve_in(ws, problem, &opts);
+    long warm = workspace_heap_allocations(ws);
+    start = now_seconds();
+    for (int k = 0; k < num_solves; k++) {
+        simplex_solve_in(ws, problem, &opts);
+    }
+    double reuse_time = now_seconds() - start;
+    long allocations = workspace_heap_allocations(ws) - warm;
+    
+    printf("%6d x %-4d | %6d | %10.2f us | %10.2f us | %5.2fx | %ld\n",
+           num_foods, num_nutrients, num_solves, fresh_time * 1e6 / num_solves, reuse_time * 1e6 / num_solves,
+           fresh_time / reuse_time, allocations);
+    free_workspace(ws);
+    free_diet_problem(problem);
+}
+
+static void bench_warm_start(int num_foods, int num_nutrients) {
+    DietProblem* problem = generate_catalogue(num_foods, num_nutrients, 0.3, 13);
+    SolverOptions cold = solver_options_default();
+    cold.engine = ENGINE_REVISED;
+    cold.presolve = 0;
+    cold.scaling = 0;
+    Solution* base = simplex_solve(problem, &cold);
+    SolverOptions warm = cold;
+    warm.warm_basis = base->basis;
+    
+    int binding = 0;
+    for (int i = 1; i < num_nutrients; i++) {
+        if (base->shadow_prices[i] > base->shadow_prices[binding]) binding = i;
+    }
+    int staple = 0;
+    for (int j = 1; j < num_foods; j++) {
+        if (base->amounts[j] > base->amounts[staple]) staple = j;
+    }
+    
+    const char* changes[2] = { "requirement +10%", "food price +30%" };
+    for (int c = 0; c < 2; c++) {
+        double saved;
+        int index = c == 0 ? binding : staple;
+        if (c == 0) {
+            saved = problem->requirements[index];
+            problem->requirements[index] *= 1.1;
+        } else {
+            saved = problem->costs[index];
+            problem->costs[index] *= 1.3;
+        }
+        
+        double times[2];
+        int iterations[2];
+        double costs[2];
+        const SolverOptions* modes[2] = { &cold, &warm };
+        for (int k = 0; k < 2; k++) {
+            double start = now_seconds();
+            Solution* sol = simplex_solve(problem, modes[k]);
+            times[k] = now_seconds() - start;
+            iterations[k] = sol ? sol->iterations : -1;
+            costs[k] = sol ? sol->total_cost : NAN;
+            if (sol) free_solution(sol);
+        }
+        printf("%6d x %-4d | %-16s | %5d / %-5d | %9.3f / %-9.3f | $%.4f / $%.4f\n",
+               num_foods, num_nutrients, changes[c], iterations[0], iterations[1],
+               times[0] * 1e3, times[1] * 1e3, costs[0], costs[1]);
+        
+        if (c == 0) problem->requirements[index] = saved;
+        else problem->costs[index] = saved;
+    }
+    
+    free_solution(base);
+    free_diet_problem(problem);
+}
+
+/*
+ * Rescales each nutrient row of a CSC catalogue by a random power of ten in
+ * [1e-3, 1e3], the way mixing mg, g and kcal units does. With `degenerate`
+ * set, values and requirements are first rounded up to multiples of 10 so
+ * that many ratios tie.
+ */
+static void make_ill_conditioned(DietProblem* p, int degenerate, unsigned long long seed) {
+    double* scale = (double*)malloc(p->num_nutrients * sizeof(double));
+    for (int i = 0; i < p->num_nutrients; i++) {
+        scale[i] = pow(10.0, (int)(uniform_random(&seed) * 7.0) - 3);
+        if (degenerate) p->requirements[i] = ceil(p->requirements[i] / 10.0) * 10.0;
+        p->requirements[i] *= scale[i];
+    }
+    for (int k = 0; k < p->nnz; k++) {
+        if (degenerate) p->values[k] = ceil(p->values[k] / 10.0) * 10.0;
+        p->values[k] *= scale[p->row_index[k]];
+    }
+    free(scale);
+}
+
+static void shape_ill_conditioned(DietProblem* p, unsigned long long seed) {
+    make_ill_conditioned(p, 0, seed);
+}
+
+static void shape_ill_degenerate(DietProblem* p, unsigned long long seed) {
+    make_ill_conditioned(p, 1, seed);
+}
+
+/* Small integer data and equal requirements: many foods tie and many requirements bind at once. */
+static void make_tied_catalogue(DietProblem* p, unsigned long long seed) {
+    for (int j = 0; j < p->num_foods; j++) {
+        p->costs[j] = 1.0 + (int)(uniform_random(&seed) * 3.0);
+    }
+    for (int k = 0; k < p->nnz; k++) {
+        p->values[k] = (int)(uniform_random(&seed) * 3.0);
+    }
+    for (int i = 0; i < p->num_nutrients; i++) {
+        p->requirements[i] = 10.0;
+    }
+}
+
+/* Worst relative requirement shortfall and worst reduced cost implied by the reported duals. */
+static void solution_residuals(const DietProblem* p, const Solution* sol, double* primal, double* dual) {
+    double* supplied = (double*)calloc(p->num_nutrients, sizeof(double));
+    *primal = NAN;
+    *dual = NAN;
+    if (!supplied) return;
+    *dual = 0.0;
+    for (int j = 0; j < p->num_foods; j++) {
+        double d = p->costs[j];
+        for (int k = p->col_start[j]; k < p->col_start[j + 1]; k++) {
+            supplied[p->row_index[k]] += p->values[k] * sol->amounts[j];
+            d -= p->values[k] * sol->shadow_prices[p->row_index[k]];
+        }
+        *dual = fmax(*dual, -d);
+    }
+    *primal = 0.0;
+    for (int i = 0; i < p->num_nutrients; i++) {
+        double shortfall = p->requirements[i] - supplied[i];
+        *primal = fmax(*primal, shortfall / fmax(1.0, fabs(p->requirements[i])));
+    }
+    free(supplied);
+}
+
+/*
+ * The solver sweeps below share one loop: problem k of a sweep is
+ * generate_catalogue(..., seed + k), reshaped by shape(p, shape_seed + k)
+ * when shape is set, and solved `repeats` times under the options being
+ * compared. bench_sweep gathers what the tables print.
+ */
+typedef struct {
+    int num_foods;
+    int num_nutrients;
+    double density;
+    int num_problems;
+    unsigned long long seed;
+    void (*shape)(DietProblem* p, unsigned long long seed);
+    unsigned long long shape_seed;
+} SweepProblems;
+
+typedef struct {
+    int failed;             /* solves that were NULL or not optimal */
+    long iterations;        /* over optimal solves, as are the fields below */
+    long degenerate_pivots;
+    double elapsed;         /* summed over problems, the fastest repeat of each */
+    double primal;          /* worst residuals */
+    double dual;
+    double range_before;
+    double range_after;
+    double total_cost;      /* of the last problem */
+    PresolveStats presolve; /* of the last problem */
+} SweepTotals;
+
+static SweepTotals bench_sweep(const SweepProblems* problems, const SolverOptions* opts, int repeats) {
+    SweepTotals totals = { 0 };
+    totals.total_cost = NAN;
+    for (int k = 0; k < problems->num_problems; k++) {
+        DietProblem* problem = generate_catalogue(problems->num_foods, problems->num_nutrients, problems->density,
+                                                  problems->seed + k);
+        if (!problem) {
+            totals.failed++;
+            continue;
+        }
+        if (problems->shape) problems->shape(problem, problems->shape_seed + k);
+        
+        double best = INFINITY;
+        Solution* sol = NULL;
+        for (int rep = 0; rep < repeats; rep++) {
+            if (sol) free_solution(sol);
+            double start = now_seconds();
+            sol = simplex_solve(problem, opts);
+            best = fmin(best, now_seconds() - start);
+        }
+        totals.elapsed += best;
+        if (!sol || sol->status != SOLVE_OPTIMAL) {
+            totals.failed++;
+        } else {
+            double p, d;
+            solution_residuals(problem, sol, &p, &d);
+            totals.primal = fmax(totals.primal, p);
+            totals.dual = fmax(totals.dual, d);
+            totals.iterations += sol->iterations;
+            totals.degenerate_pivots += sol->degenerate_pivots;
+            totals.range_before = fmax(totals.range_before, sol->scaling.range_before);
+            totals.range_after = fmax(totals.range_after, sol->scaling.range_after);
+            totals.total_cost = sol->total_cost;
+            totals.presolve = sol->presolve;
+        }
+        if (sol) free_solution(sol);
+        free_diet_problem(problem);
+    }
+    return totals;
+}
+
+/* Options for one sweep: the engine, with presolve and scaling off unless the bench compares them. */
+static SolverOptions sweep_options(int engine) {
+    SolverOptions opts = solver_options_default();
+    opts.engine = (SimplexEngine)engine;
+    opts.presolve = 0;
+    opts.scaling = 0;
+    return opts;
+}
+
+static void bench_pricing(int num_foods, int num_nutrients) {
+    SweepProblems problems = { num_foods, num_nutrients, 0.3, 1, 17, NULL, 0 };
+    for (int engine = ENGINE_TABLEAU; engine <= ENGINE_REVISED; engine++) {
+        for (int rule = 0; rule < NUM_PRICING_RULES; rule++) {
+            SolverOptions opts = sweep_options(engine);
+            opts.pricing = (PricingRule)rule;
+            SweepTotals t = bench_sweep(&problems, &opts, 3);
+            printf("%6d x %-4d | %-7s | %-13s | %6ld | %10.3f ms | $%.6f\n",
+                   num_foods, num_nutrients, engine == ENGINE_TABLEAU ? "tableau" : "revised",
+                   pricing_names[rule], t.iterations, t.elapsed * 1e3, t.total_cost);
+        }
+    }
+}
+
+static void bench_ratio_test(int num_foods, int num_nutrients, int num_problems, int degenerate) {
+    const char* names[2] = { "harris", "textbook" };
+    SweepProblems problems = { num_foods, num_nutrients, 0.3, num_problems, 100,
+                               degenerate ? shape_ill_degenerate : shape_ill_conditioned, 200 };
+    for (int engine = ENGINE_TABLEAU; engine <= ENGINE_REVISED; engine++) {
+        for (int test = RATIO_HARRIS; test <= RATIO_TEXTBOOK; test++) {
+            SolverOptions opts = sweep_options(engine);
+            opts.ratio_test = (RatioTest)test;
+            SweepTotals t = bench_sweep(&problems, &opts, 1);
+            printf("%5d x %-3d %-4s | %-7s | %-8s | %7ld | %10.3f ms | %6d | %9.1e | %9.1e\n",
+                   num_foods, num_nutrients, degenerate ? "deg" : "", engine == ENGINE_TABLEAU ? "tableau" : "revised",
+                   names[test], t.iterations, t.elapsed * 1e3, t.failed, t.primal, t.dual);
+        }
+    }
+}
+
+static void bench_scaling(int num_foods, int num_nutrients, int num_problems) {
+    SweepProblems problems = { num_foods, num_nutrients, 0.3, num_problems, 100, shape_ill_conditioned, 200 };
+    for (int engine = ENGINE_TABLEAU; engine <= ENGINE_REVISED; engine++) {
+        for (int scaling = 0; scaling <= 1; scaling++) {
+            SolverOptions opts = sweep_options(engine);
+            opts.scaling = scaling;
+            SweepTotals t = bench_sweep(&problems, &opts, 1);
+            printf("%5d x %-3d | %-7s | %-3s | %7ld | %10.3f ms | %6d | %7.1e -> %7.1e | %9.1e | %9.1e\n",
+                   num_foods, num_nutrients, engine == ENGINE_TABLEAU ? "tableau" : "revised",
+                   scaling ? "on" : "off", t.iterations, t.elapsed * 1e3, t.failed, t.range_before, t.range_after,
+                   t.primal, t.dual);
+        }
+    }
+}
+
+static void bench_degeneracy(int num_foods, int num_nutrients, int num_problems) {
+    SweepProblems problems = { num_foods, num_nutrients, 0.5, num_problems, 300, make_tied_catalogue, 400 };
+    for (int engine = ENGINE_TABLEAU; engine <= ENGINE_REVISED; engine++) {
+        for (int rule = DEGENERACY_PERTURB; rule <= DEGENERACY_NONE; rule++) {
+            SolverOptions opts = sweep_options(engine);
+            opts.pricing = PRICING_STEEPEST_EDGE;
+            opts.degeneracy = (DegeneracyRule)rule;
+            SweepTotals t = bench_sweep(&problems, &opts, 1);
+            printf("%5d x %-5d | %-7s | %-7s | %7ld | %7ld (%4.1f%%) | %10.3f ms | %6d\n",
+                   num_foods, num_nutrients, engine == ENGINE_TABLEAU ? "tableau" : "revised",
+                   degeneracy_names[rule], t.iterations, t.degenerate_pivots,
+                   100.0 * t.degenerate_pivots / (t.iterations > 0 ? t.iterations : 1), t.elapsed * 1e3, t.failed);
+        }
+    }
+}
+
+static void bench_presolve(int num_foods, int num_nutrients, int tied) {
+    SweepProblems problems = { num_foods, num_nutrients, 0.3, 1, 23, tied ? make_tied_catalogue : NULL, 29 };
+    for (int engine = ENGINE_TABLEAU; engine <= ENGINE_REVISED; engine++) {
+        SolverOptions opts = sweep_options(engine);
+        opts.pricing = engine == ENGINE_REVISED ? PRICING_PARTIAL : PRICING_DANTZIG;
+        SweepTotals plain = bench_sweep(&problems, &opts, 1);
+        opts.presolve = 1;
+        SweepTotals reduced = bench_sweep(&problems, &opts, 1);
+        if (plain.failed || reduced.failed) continue;
+        
+        const PresolveStats* stats = &reduced.presolve;
+        printf("%6d x %-3d %-4s | %-7s | %6d x %-3d | %5d / %-5d | %8.2f ms | %9.2f ms | %9.2f ms | %.1e\n",
+               num_foods, num_nutrients, tied ? "tied" : "", engine == ENGINE_TABLEAU ? "tableau" : "revised",
+               stats->num_foods, stats->num_nutrients, stats->dominated_foods, stats->duplicate_foods,
+               stats->elapsed_ns * 1e-6, plain.elapsed * 1e3, reduced.elapsed * 1e3,
+               fabs(plain.total_cost - reduced.total_cost));
+    }
+}
+
+/* Revised engine only: pricing dominates its per-pivot cost on wide catalogues. */
+static void bench_partial_pricing(int num_foods, int num_nutrients) {
+    SweepProblems problems = { num_foods, num_nutrients, 0.3, 1, 19, NULL, 0 };
+    PricingRule rules[2] = { PRICING_DANTZIG, PRICING_PARTIAL };
+    for (int k = 0; k < 2; k++) {
+        SolverOptions opts = sweep_options(ENGINE_REVISED);
+        opts.pricing = rules[k];
+        SweepTotals t = bench_sweep(&problems, &opts, 1);
+        if (t.failed) continue;
+        printf("%6d x %-4d | %-8s | %6ld | %10.3f ms | %10.2f us | $%.6f\n",
+               num_foods, num_nutrients, pricing_names[rules[k]], t.iterations, t.elapsed * 1e3,
+               t.elapsed * 1e6 / (t.iterations > 0 ? t.iterations : 1), t.total_cost);
+    }
+}
+
+/* The column scan that extraction used before it read the basis array, kept as a baseline. */
+static void scan_extract_amounts(Tableau* t, int num_foods, int num_constraints, double* amounts) {
+    for (int j = 0; j < num_foods; j++) {
+        amounts[j] = 0.0;
+        for (int i = 0; i < num_constraints; i++) {
+            if (fabs(TABLEAU_AT(t, i, j) - 1.0) < EPSILON) {
+                int all_zero = 1;
+                for (int k = 0; k < num_constraints; k++) {
+                    if (k != i && fabs(TABLEAU_AT(t, k, j)) > EPSILON) {
+                        all_zero = 0;
+                        break;
+                    }
+                }
+                if (all_zero) {
+                    amounts[j] = fmax(0.0, TABLEAU_AT(t, i, t->cols - 1));
+                    break;
+                }
+            }
+        }
+    }
+}
+
+static void bench_extraction(int num_foods, int num_nutrients) {
+    DietProblem* problem = generate_catalogue(num_foods, num_nutrients, 0.3, 13);
+    SolverOptions opts = solver_options_default();
+    opts.presolve = 0;
+    opts.scaling = 0;
+    SolverWorkspace* ws = create_workspace(num_foods, num_nutrients);
+    Solution* sol = create_solution(num_foods, num_nutrients);
+    double* scanned = (double*)malloc(num_foods * sizeof(double));
+    if (!ws || !sol || !scanned) {
+        free(scanned);
+        if (sol) free_solution(sol);
+        free_workspace(ws);
+        free_diet_problem(problem);
+        return;
+    }
+    
+    double start = now_seconds();
+    solve_into(problem, problem->requirements, ws, &opts, sol);
+    double solve_time = now_seconds() - start;
+    
+    double scan_time = INFINITY;
+    double basis_time = INFINITY;
+    for (int rep = 0; rep < 5; rep++) {
+        start = now_seconds();
+        scan_extract_amounts(ws->tableau, num_foods, num_nutrients, scanned);
+        scan_time = fmin(scan_time, now_seconds() - start);
+        
+        start = now_seconds();
+        reset_solution(sol, num_foods, num_nutrients);
+        extract_tableau_solution(ws->tableau, problem, sol);
+        basis_time = fmin(basis_time, now_seconds() - start);
+    }
+    
+    double diff = 0.0;
+    for (int j = 0; j < num_foods; j++) {
+        diff = fmax(diff, fabs(scanned[j] - sol->amounts[j]));
+    }
+    printf("%6d x %-4d | %10.3f ms | %10.1f us | %10.1f us | %6.1fx | %.1e\n",
+           num_foods, num_nutrients, solve_time * 1e3, scan_time * 1e6, basis_time * 1e6,
+           scan_time / basis_time, diff);
+    
+    free(scanned);
+    free_solution(sol);
+    free_workspace(ws);
+    free_diet_problem(problem);
+}
+
+int run_benchmarks(void) {
+    printf("\n========================================\n");
+    printf("      TABLEAU LAYOUT BENCHMARK\n");
+    printf("========================================\n");
+    printf(" Foods x Nutr | Layout     | Pivots |   ns / pivot | Allocs\n");
+    printf("----------------------------------------------------------\n");
+    bench_layout(50, 10, 100000);
+    bench_layout(5000, 500, 20);
+    
+    printf("\n========================================\n");
+    printf("      ROW ELIMINATION KERNELS\n");
+    printf("========================================\n");
+    printf(" Foods x Nutr | Kernel   |   ns / pivot | GFLOP/s | Speedup\n");
+    printf("----------------------------------------------------------\n");
+    bench_kernels(20000, 40, 200);
+    bench_kernels(4000, 200, 100);
+    
+    printf("\n========================================\n");
+    printf("      PARALLEL PIVOT SCALING\n");
+    printf("========================================\n");
+    printf(" Foods x Nutr | Threads |   ns / pivot | Speedup\n");
+    printf("-----------------------------------------------\n");
+    bench_threads(40000, 40, 100);
+    bench_threads(10000, 200, 50);
+    
+    printf("\n========================================\n");
+    printf("      SPARSE CATALOGUE BENCHMARK\n");
+    printf("========================================\n");
+    printf(" Foods x Nutr |  Dens | Matrix |        Memory |    Solve time | Cost\n");
+    printf("---------------------------------------------------------------------\n");
+    bench_sparse(2000, 40, 0.3);
+    bench_sparse(20000, 60, 0.25);
+    
+    printf("\n========================================\n");
+    printf("      BATCH SOLVE\n");
+    printf("========================================\n");
+    printf(" Foods x Nutr | Solves | Mode         | Time / solve\n");
+    printf("----------------------------------------------------\n");
+    bench_batch(200, 10, 20000);
+    
+    printf("\n========================================\n");
+    printf("      WORKSPACE REUSE\n");
+    printf("========================================\n");
+    printf(" Foods x Nutr | Solves | simplex_solve | simplex_solve_in | Speedup | Allocs after warm-up\n");
+    printf("------------------------------------------------------------------------------------\n");
+    bench_workspace(8, 5, 100000);
+    bench_workspace(50, 10, 20000);
+    bench_workspace(200, 20, 5000);
+    
+    printf("\n========================================\n");
+    printf("      WARM-START RE-SOLVE\n");
+    printf("========================================\n");
+    printf(" Foods x Nutr | Change           | Iters cold/warm | ms cold / warm      | Cost cold / warm\n");
+    printf("-------------------------------------------------------------------------------------------\n");
+    bench_warm_start(2000, 40);
+    bench_warm_start(20000, 60);
+    
+    printf("\n========================================\n");
+    printf("      PRICING RULES\n");
+    printf("========================================\n");
+    printf(" Foods x Nutr | Engine  | Pricing       | Iters  |    Solve time | Cost\n");
+    printf("-----------------------------------------------------------------------------\n");
+    bench_pricing(2000, 40);
+    bench_pricing(10000, 60);
+    
+    printf("\n========================================\n");
+    printf("      RATIO TESTS ON ILL-SCALED CATALOGUES\n");
+    printf("========================================\n");
+    printf(" Foods x Nutr     | Engine  | Test     |   Iters |    Total time | Failed | Primal res | Dual res\n");
+    printf("-------------------------------------------------------------------------------------------------\n");
+    bench_ratio_test(200, 20, 50, 0);
+    bench_ratio_test(200, 20, 50, 1);
+    
+    printf("\n========================================\n");
+    printf("      SCALING ON ILL-SCALED CATALOGUES\n");
+    printf("========================================\n");
+    printf(" Foods x Nutr | Engine  | Scl |   Iters |    Total time | Failed | |a| range (worst)  | Primal res | Dual res\n");
+    printf("---------------------------------------------------------------------------------------------------------------\n");
+    bench_scaling(200, 20, 50);
+    bench_scaling(2000, 40, 10);
+    
+    printf("\n========================================\n");
+    printf("      DEGENERACY ON TIED CATALOGUES\n");
+    printf("========================================\n");
+    printf(" Foods x Nutr | Engine  | Rule    |   Iters |  Degenerate     |    Total time | Failed\n");
+    printf("---------------------------------------------------------------------------------------\n");
+    bench_degeneracy(300, 30, 30);
+    bench_degeneracy(1000, 40, 10);
+    
+    printf("\n========================================\n");
+    printf("      PRESOLVE\n");
+    printf("========================================\n");
+    printf(" Foods x Nutr     | Engine  | Reduced to   | Dom / Dup     | Presolve    | Solve (off)  | Solve (on)   | Cost diff\n");
+    printf("-----------------------------------------------------------------------------------------------------------------\n");
+    bench_presolve(1000, 40, 0);
+    bench_presolve(1000, 40, 1);
+    bench_presolve(20000, 40, 0);
+    bench_presolve(20000, 40, 1);
+    
+    printf("\n========================================\n");
+    printf("      PARTIAL PRICING (REVISED ENGINE)\n");
+    printf("========================================\n");
+    printf(" Foods x Nutr | Pricing  | Iters  |    Solve time | Per pivot     | Cost\n");
+    printf("---------------------------------------------------------------------------\n");
+    bench_partial_pricing(5000, 40);
+    bench_partial_pricing(20000, 40);
+    bench_partial_pricing(50000, 40);
+    
+    printf("\n========================================\n");
+    printf("      SOLUTION EXTRACTION\n");
+    printf("========================================\n");
+    printf(" Foods x Nutr |      Solve    |  Column scan  | Basis lookup  | Speedup | Max diff\n");
+    printf("---------------------------------------------------------------------------------\n");
+    bench_extraction(1000, 40);
+    bench_extraction(10000, 40);
+    bench_extraction(50000, 40);
+    printf("\n");
+    return 0;
+}
 
-typedef struct {
-    char name[50];
-    double cost;
-    double nutrients[MAX_CONSTRAINTS];
-} Food;
+/*
+ * Benchmark suite for regression tracking: `--bench-suite` solves every
+ * instance with both engines and writes one record per run as CSV or JSON.
+ * The instances are the reference diets from database/schema.sql, followed
+ * by generated catalogues for every combination of --sizes, --density and
+ * --degenerate. Seeds are fixed, so two runs of one build see the same LPs.
+ */
+#define SUITE_MAX_LIST 16
 
-typedef struct {
-    double** matrix;
-    int rows;
-    int cols;
-    int* basis;
-} Tableau;
+static Food reference_foods[] = {
+    {"Oatmeal", 0.50, {5.0, 27.0, 3.0, 4.0, 15.0}},
+    {"Chicken Breast", 3.00, {31.0, 0.0, 3.6, 0.0, 10.0}},
+    {"Brown Rice", 0.30, {2.6, 23.0, 0.9, 1.8, 5.0}},
+    {"Broccoli", 1.50, {2.8, 7.0, 0.4, 2.6, 135.0}},
+    {"Banana", 0.25, {1.3, 27.0, 0.3, 3.1, 17.0}},
+    {"Eggs", 2.00, {13.0, 1.1, 11.0, 0.0, 15.0}},
+    {"Almonds", 4.50, {21.0, 22.0, 49.0, 12.0, 26.0}},
+    {"Milk", 1.20, {8.0, 12.0, 8.0, 0.0, 50.0}},
+    {"Spinach", 2.00, {2.9, 3.6, 0.4, 2.2, 188.0}},
+    {"Sweet Potato", 0.80, {1.6, 20.0, 0.1, 3.0, 384.0}}
+};
+
+static const struct {
+    const char* name;
+    double requirements[5];
+} reference_diets[] = {
+    {"standard-adult", {50.0, 130.0, 44.0, 25.0, 100.0}},
+    {"high-protein", {100.0, 100.0, 40.0, 30.0, 100.0}},
+    {"low-carb", {75.0, 50.0, 70.0, 25.0, 100.0}},
+    {"balanced", {60.0, 150.0, 50.0, 30.0, 120.0}}
+};
 
 typedef struct {
-    double* amounts;
-    double total_cost;
-    double* shadow_prices;
-    int feasible;
-} Solution;
+    int json;
+    int repeats;
+    unsigned long long seed;
+    int num_sizes;
+    int foods[SUITE_MAX_LIST];
+    int nutrients[SUITE_MAX_LIST];
+    int num_densities;
+    double densities[SUITE_MAX_LIST];
+    int num_degeneracies;
+    double degeneracies[SUITE_MAX_LIST];
+    int records;
+} BenchSuite;
 
-Tableau* create_tableau(int rows, int cols) {
-    Tableau* t = (Tableau*)malloc(sizeof(Tableau));
-    t->rows = rows;
-    t->cols = cols;
-    t->matrix = (double**)malloc(rows * sizeof(double*));
-    for (int i = 0; i < rows; i++) {
-        t->matrix[i] = (double*)calloc(cols, sizeof(double));
+/*
+ * make_tied_catalogue for a `fraction` of the foods: their prices become 1-3
+ * dollars and their nutrients 0-2 times the row's mean entry, and every
+ * requirement becomes ten times that mean. Tied ratios and reduced costs
+ * make pivots degenerate, more of them as the fraction grows. -1, with
+ * the problem untouched, if the row means cannot be allocated.
+ */
+static int make_degenerate(DietProblem* p, double fraction, unsigned long long seed) {
+    if (fraction <= 0.0) return 0;
+    int m = p->num_nutrients;
+    double* mean = (double*)calloc(m, sizeof(double));
+    int* count = (int*)calloc(m, sizeof(int));
+    if (!mean || !count) {
+        free(mean);
+        free(count);
+        return -1;
     }
-    t->basis = (int*)malloc(rows * sizeof(int));
-    return t;
+    for (int k = 0; k < p->nnz; k++) {
+        mean[p->row_index[k]] += p->values[k];
+        count[p->row_index[k]]++;
+    }
+    for (int i = 0; i < m; i++) {
+        mean[i] = count[i] ? mean[i] / count[i] : 1.0;
+        p->requirements[i] = 10.0 * mean[i];
+    }
+    for (int j = 0; j < p->num_foods; j++) {
+        if (uniform_random(&seed) >= fraction) continue;
+        p->costs[j] = 1.0 + (int)(uniform_random(&seed) * 3.0);
+        for (int k = p->col_start[j]; k < p->col_start[j + 1]; k++) {
+            p->values[k] = mean[p->row_index[k]] * (int)(uniform_random(&seed) * 3.0);
+        }
+    }
+    free(mean);
+    free(count);
+    return 0;
 }
 
-void free_tableau(Tableau* t) {
-    for (int i = 0; i < t->rows; i++) {
-        free(t->matrix[i]);
-    }
-    free(t->matrix);
-    free(t->basis);
-    free(t);
+static long peak_rss_kb(void) {
+    struct rusage usage;
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss : -1;
 }
 
-void print_tableau(Tableau* t) {
-    printf("\n=== Simplex Tableau ===\n");
-    for (int i = 0; i < t->rows; i++) {
-        for (int j = 0; j < t->cols; j++) {
-            printf("%8.3f ", t->matrix[i][j]);
+/* Solves `problem` once cold and `repeats` times warm with each engine, one record per engine. */
+static void suite_run(BenchSuite* suite, const char* instance, const DietProblem* problem, double degeneracy,
+                      unsigned long long seed) {
+    int n = problem->num_foods;
+    int m = problem->num_nutrients;
+    int nnz = problem->nutrients ? n * m : problem->col_start[n];
+    for (int engine = ENGINE_TABLEAU; engine <= ENGINE_REVISED; engine++) {
+        SolverOptions opts = solver_options_default();
+        opts.engine = (SimplexEngine)engine;
+        SolverWorkspace* ws = create_workspace(n, m);
+        Solution* sol = simplex_solve_in(ws, problem, &opts);
+        long cold = 1 + workspace_heap_allocations(ws);
+        simplex_solve_in(ws, problem, &opts);
+        long warm = workspace_heap_allocations(ws);
+        long long best = -1;
+        for (int rep = 0; rep < suite->repeats; rep++) {
+            long long start = monotonic_ns();
+            sol = simplex_solve_in(ws, problem, &opts);
+            long long elapsed = monotonic_ns() - start;
+            if (best < 0 || elapsed < best) best = elapsed;
         }
-        if (i < t->rows - 1) {
-            printf("| Basis: %d", t->basis[i]);
+        warm = workspace_heap_allocations(ws) - warm;
+        
+        const char* engine_name = engine == ENGINE_TABLEAU ? "tableau" : "revised";
+        const char* status = sol ? solve_status_name(sol->status) : "failed";
+        int iterations = sol ? sol->iterations : 0;
+        int degenerate = sol ? sol->degenerate_pivots : 0;
+        double cost = sol ? sol->total_cost : NAN;
+        double pivots_per_sec = iterations > 0 ? iterations * 1e9 / best : 0.0;
+        double ns_per_pivot = iterations > 0 ? (double)best / iterations : 0.0;
+        double density = (double)nnz / ((double)n * m);
+        char cost_text[32];
+        if (isnan(cost)) {
+            snprintf(cost_text, sizeof(cost_text), "%s", suite->json ? "null" : "");
+        } else {
+            snprintf(cost_text, sizeof(cost_text), "%.9g", cost);
         }
-        printf("\n");
+        if (suite->json) {
+            printf("%s\n  {\"instance\": \"%s\", \"foods\": %d, \"nutrients\": %d, \"density\": %.4f, "
+                   "\"degeneracy\": %.2f, \"seed\": %llu, \"engine\": \"%s\", \"status\": \"%s\", "
+                   "\"iterations\": %d, \"degenerate_pivots\": %d, \"total_cost\": %s, \"solve_ns\": %lld, "
+                   "\"pivots_per_sec\": %.1f, \"ns_per_pivot\": %.1f, \"peak_rss_kb\": %ld, "
+                   "\"allocs_cold\": %ld, \"allocs_warm\": %ld}",
+                   suite->records ? "," : "[", instance, n, m, density, degeneracy, seed, engine_name, status,
+                   iterations, degenerate, cost_text, best, pivots_per_sec, ns_per_pivot, peak_rss_kb(), cold, warm);
+        } else {
+            printf("%s,%d,%d,%.4f,%.2f,%llu,%s,%s,%d,%d,%s,%lld,%.1f,%.1f,%ld,%ld,%ld\n",
+                   instance, n, m, density, degeneracy, seed, engine_name, status, iterations, degenerate, cost_text,
+                   best, pivots_per_sec, ns_per_pivot, peak_rss_kb(), cold, warm);
+        }
+        fflush(stdout);
+        suite->records++;
+        free_workspace(ws);
     }
-    printf("=======================\n");
 }
 
-int find_pivot_column(Tableau* t) {
-    int pivot_col = -1;
-    double min_val = 0.0;
-    
-    for (int j = 0; j < t->cols - 1; j++) {
-        if (t->matrix[t->rows - 1][j] < min_val) {
-            min_val = t->matrix[t->rows - 1][j];
-            pivot_col = j;
-        }
+/* Comma-separated numbers into out[], at most SUITE_MAX_LIST; returns the count. */
+static int parse_suite_list(const char* text, double* out) {
+    int count = 0;
+    while (*text && count < SUITE_MAX_LIST) {
+        char* end;
+        out[count++] = strtod(text, &end);
+        if (*end != ',') break;
+        text = end + 1;
     }
-    
-    return pivot_col;
+    return count;
 }
 
-int find_pivot_row(Tableau* t, int pivot_col) {
-    int pivot_row = -1;
-    double min_ratio = INFINITY;
-    
-    for (int i = 0; i < t->rows - 1; i++) {
-        if (t->matrix[i][pivot_col] < -EPSILON) {
-            double ratio = -t->matrix[i][t->cols - 1] / t->matrix[i][pivot_col];
-            if (ratio > 0 && ratio < min_ratio) {
-                min_ratio = ratio;
-                pivot_row = i;
-            }
-        }
+/* "NxM,NxM,..." into foods[] and nutrients[]; returns the count. */
+static int parse_suite_sizes(const char* text, int* foods, int* nutrients) {
+    int count = 0;
+    while (*text && count < SUITE_MAX_LIST) {
+        char* end;
+        foods[count] = (int)strtol(text, &end, 10);
+        if (*end != 'x') break;
+        nutrients[count] = (int)strtol(end + 1, &end, 10);
+        if (foods[count] > 0 && nutrients[count] > 0) count++;
+        if (*end != ',') break;
+        text = end + 1;
     }
-    
-    return pivot_row;
+    return count;
 }
 
-void pivot_operation(Tableau* t, int pivot_row, int pivot_col) {
-    double pivot_element = t->matrix[pivot_row][pivot_col];
-    
-    for (int j = 0; j < t->cols; j++) {
-        t->matrix[pivot_row][j] /= pivot_element;
+int run_bench_suite(int argc, char** argv) {
+    BenchSuite suite = { 0 };
+    suite.repeats = 3;
+    suite.seed = 1;
+    suite.num_sizes = parse_suite_sizes("8x5,100x10,1000x40,10000x60,100000x20,2000x200", suite.foods,
+                                        suite.nutrients);
+    suite.num_densities = parse_suite_list("0.3", suite.densities);
+    suite.num_degeneracies = parse_suite_list("0,0.5", suite.degeneracies);
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--format=json") == 0) suite.json = 1;
+        if (strcmp(argv[i], "--format=csv") == 0) suite.json = 0;
+        if (strncmp(argv[i], "--repeats=", 10) == 0) suite.repeats = atoi(argv[i] + 10);
+        if (strncmp(argv[i], "--seed=", 7) == 0) suite.seed = strtoull(argv[i] + 7, NULL, 10);
+        if (strncmp(argv[i], "--sizes=", 8) == 0) {
+            suite.num_sizes = parse_suite_sizes(argv[i] + 8, suite.foods, suite.nutrients);
+        }
+        if (strncmp(argv[i], "--density=", 10) == 0) {
+            suite.num_densities = parse_suite_list(argv[i] + 10, suite.densities);
+        }
+        if (strncmp(argv[i], "--degenerate=", 13) == 0) {
+            suite.num_degeneracies = parse_suite_list(argv[i] + 13, suite.degeneracies);
+        }
     }
+    if (suite.repeats < 1) suite.repeats = 1;
     
-    for (int i = 0; i < t->rows; i++) {
-        if (i != pivot_row) {
-            double factor = t->matrix[i][pivot_col];
-            for (int j = 0; j < t->cols; j++) {
-                t->matrix[i][j] -= factor * t->matrix[pivot_row][j];
+    if (!suite.json) {
+        printf("instance,foods,nutrients,density,degeneracy,seed,engine,status,iterations,degenerate_pivots,"
+               "total_cost,solve_ns,pivots_per_sec,ns_per_pivot,peak_rss_kb,allocs_cold,allocs_warm\n");
+    }
+    int num_foods = sizeof(reference_foods) / sizeof(reference_foods[0]);
+    for (size_t d = 0; d < sizeof(reference_diets) / sizeof(reference_diets[0]); d++) {
+        double requirements[5];
+        memcpy(requirements, reference_diets[d].requirements, sizeof(requirements));
+        DietProblem* problem = diet_problem_from_foods(reference_foods, num_foods, requirements, 5);
+        suite_run(&suite, reference_diets[d].name, problem, 0.0, 0);
+        free_diet_problem(problem);
+    }
+    for (int k = 0; k < suite.num_sizes; k++) {
+        for (int d = 0; d < suite.num_densities; d++) {
+            for (int g = 0; g < suite.num_degeneracies; g++) {
+                unsigned long long seed = suite.seed + k;
+                DietProblem* problem = generate_catalogue(suite.foods[k], suite.nutrients[k], suite.densities[d], seed);
+                if (!problem) {
+                    fprintf(stderr, "bench-suite: no memory for %d x %d, skipped\n", suite.foods[k], suite.nutrients[k]);
+                    continue;
+                }
+                /* Out of memory for the degeneracy pass: the plain catalogue is solved and recorded as such. */
+                double degeneracy = suite.degeneracies[g];
+                if (make_degenerate(problem, degeneracy, seed) != 0) {
+                    fprintf(stderr, "bench-suite: no memory to make %d x %d degenerate, solved as generated\n",
+                            suite.foods[k], suite.nutrients[k]);
+                    degeneracy = 0.0;
+                }
+                suite_run(&suite, "generated", problem, degeneracy, seed);
+                free_diet_problem(problem);
             }
         }
     }
+    if (suite.json) printf("%s]\n", suite.records ? "\n" : "[");
+    return 0;
+}
+
+/*
+ * Zero-copy problems and tableau playback for callers that own the data, the
+ * solver service and the Node addon. A view borrows the caller's arrays and
+ * has no names, which the solver never reads.
+ */
+#define MAX_SNAPSHOTS 100
+#define MAX_SNAPSHOT_CELLS (1 << 22)
+
+static DietProblem diet_problem_view(int num_foods, int num_nutrients, double* costs, double* nutrients,
+                                     double* requirements) {
+    DietProblem p = { 0 };
+    p.num_foods = num_foods;
+    p.num_nutrients = num_nutrients;
+    p.costs = costs;
+    p.nutrients = nutrients;
+    p.requirements = requirements;
+    return p;
+}
+
+/*
+ * Snapshots of ws->tableau after the start and after every pivot, for
+ * playback. Only the tableau engine has a tableau to copy, and it is the
+ * caller's own only with presolve and scaling off.
+ */
+typedef struct {
+    const SolverWorkspace* ws;
+    double* cells;
+    size_t capacity;        /* doubles in cells */
+    int count;
+    int rows;
+    int cols;
+} TableauSnapshots;
+
+/* Room for MAX_SNAPSHOTS tableaux of an n x m problem, capped at MAX_SNAPSHOT_CELLS; -1 if out of memory. */
+static int reserve_snapshots(TableauSnapshots* s, int num_foods, int num_nutrients) {
+    size_t wanted = MAX_SNAPSHOTS * (size_t)(num_nutrients + 1) * (num_foods + num_nutrients + 1);
+    if (wanted > MAX_SNAPSHOT_CELLS) wanted = MAX_SNAPSHOT_CELLS;
+    s->count = 0;
+    if (wanted <= s->capacity) return 0;
+    double* grown = (double*)realloc(s->cells, wanted * sizeof(double));
+    if (!grown) return -1;
+    s->cells = grown;
+    s->capacity = wanted;
+    return 0;
+}
+
+/* A PivotTraceFn; user is the TableauSnapshots. Snapshots past the buffer are dropped. */
+static void snapshot_tableau(const PivotEvent* e, void* user) {
+    TableauSnapshots* s = (TableauSnapshots*)user;
+    const Tableau* t = s->ws->tableau;
+    if (!t || (e->kind != TRACE_START && e->kind != TRACE_PIVOT)) return;
+    size_t cells = (size_t)t->rows * t->cols;
+    if (s->count == MAX_SNAPSHOTS || (s->count + 1) * cells > s->capacity) return;
     
-    t->basis[pivot_row] = pivot_col;
+    double* dst = s->cells + s->count * cells;
+    for (int i = 0; i < t->rows; i++) {
+        memcpy(dst + (size_t)i * t->cols, &TABLEAU_AT(t, i, 0), t->cols * sizeof(double));
+    }
+    s->count++;
+    s->rows = t->rows;
+    s->cols = t->cols;
 }
 
-Solution* simplex_solve(Food* foods, int num_foods, double* constraints, int num_constraints, int verbose) {
-    int num_vars = num_foods;
-    int num_slack = num_constraints;
-    int total_cols = num_vars + num_slack + 1;
-    int total_rows = num_constraints + 1;
+/*
+ * Solver service. `--serve=PATH` runs simplex_solve behind a Unix socket so
+ * the API server hands solves to a pool of native threads instead of running
+ * them on its event loop. Frames are a ServeHeader and `bytes` of payload, in
+ * native byte order since both ends share the machine:
+ *
+ *   request:  ServeRequest, then double costs[n], nutrients[n * m] (food by
+ *             food), requirements[m]
+ *   response: ServeResponse, then double amounts[n], shadow_prices[m]; with
+ *             SERVE_TABLEAUX, a ServeTableaux and count tableaux of
+ *             rows * cols doubles (see TableauSnapshots)
+ *
+ * status is a SolveStatus or a negative ServeError. The acceptor hands
+ * connections to the workers through a bounded queue, and a connection that
+ * finds it full is answered SERVE_BUSY at once instead of waiting. A worker
+ * serves one connection until the client closes it or stays silent for the
+ * idle timeout, on its own workspace, so a warm worker solves without
+ * touching the heap and idle clients cannot hold every worker.
+ */
+#define SERVE_MAGIC 0x54454944u     /* "DIET" */
+#define SERVE_MAX_PAYLOAD (64u << 20)
+#define SERVE_IDLE_TIMEOUT_MS 30000
+#define SERVE_POLL_MS 100           /* how often the acceptor looks at the stop flag */
+
+enum {
+    SERVE_TABLEAUX = 1      /* solve the raw tableau and return its snapshots */
+};
+
+typedef enum {
+    SERVE_BAD_REQUEST = -1,
+    SERVE_BUSY = -2,
+    SERVE_FAILED = -3
+} ServeError;
+
+typedef struct {
+    unsigned int magic;
+    unsigned int bytes;
+} ServeHeader;
+
+/* Every payload struct is a multiple of 8 bytes, so the doubles after it stay aligned. */
+typedef struct {
+    int num_foods;
+    int num_nutrients;
+    int flags;
+    int reserved;
+} ServeRequest;
+
+typedef struct {
+    int status;
+    int iterations;
+    int num_foods;
+    int num_nutrients;
+    double total_cost;
+} ServeResponse;
+
+typedef struct {
+    int count;
+    int rows;
+    int cols;
+    int reserved;
+} ServeTableaux;
+
+/*
+ * idle_timeout_ms bounds every read and write on a connection; 0 waits
+ * forever. When stop is set and becomes nonzero, the service stops
+ * accepting, ends the connections in progress once their current request is
+ * answered, joins its workers and returns 0.
+ */
+typedef struct {
+    int num_threads;
+    int queue_capacity;
+    int idle_timeout_ms;
+    atomic_int* stop;
+} ServeOptions;
+
+typedef struct {
+    int* fds;
+    int capacity;
+    int head;
+    int count;
+    int stopping;
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+} ServeQueue;
+
+typedef struct {
+    ServeQueue* queue;
+    int fd;                 /* connection being served, -1 if none; guarded by the queue lock */
+    SolverWorkspace* ws;
+    unsigned char* in;
+    size_t in_size;
+    unsigned char* out;
+    size_t out_size;
+    TableauSnapshots snapshots;
+} ServeWorker;
+
+static int read_full(int fd, void* buf, size_t bytes) {
+    unsigned char* p = (unsigned char*)buf;
+    while (bytes) {
+        ssize_t got = recv(fd, p, bytes, 0);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return -1;
+        p += got;
+        bytes -= got;
+    }
+    return 0;
+}
+
+static int write_full(int fd, const void* buf, size_t bytes) {
+    const unsigned char* p = (const unsigned char*)buf;
+    while (bytes) {
+        ssize_t sent = send(fd, p, bytes, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) return -1;
+        p += sent;
+        bytes -= sent;
+    }
+    return 0;
+}
+
+/* Grows *buf to at least `bytes`, keeping its contents; -1 if out of memory. */
+static int serve_reserve(unsigned char** buf, size_t* size, size_t bytes) {
+    if (bytes <= *size) return 0;
+    unsigned char* grown = (unsigned char*)realloc(*buf, bytes);
+    if (!grown) return -1;
+    *buf = grown;
+    *size = bytes;
+    return 0;
+}
+
+static int serve_error(int fd, ServeError error) {
+    struct {
+        ServeHeader header;
+        ServeResponse response;
+    } frame = { { SERVE_MAGIC, sizeof(ServeResponse) }, { error, 0, 0, 0, NAN } };
+    return write_full(fd, &frame, sizeof(frame));
+}
+
+/* Solves the request in w->in and sends the answer; -1 when the connection should be dropped. */
+static int serve_request(ServeWorker* w, int fd, size_t bytes) {
+    ServeRequest req;
+    if (bytes < sizeof(req)) {
+        serve_error(fd, SERVE_BAD_REQUEST);
+        return -1;
+    }
+    memcpy(&req, w->in, sizeof(req));
+    /* Bounding n and then m by the payload keeps the size below from wrapping around. */
+    size_t max_doubles = SERVE_MAX_PAYLOAD / sizeof(double);
+    size_t n = req.num_foods > 0 ? (size_t)req.num_foods : 0;
+    size_t m = req.num_nutrients > 0 ? (size_t)req.num_nutrients : 0;
+    if (!n || !m || n > max_doubles || m > max_doubles / n ||
+        bytes != sizeof(req) + (n + n * m + m) * sizeof(double)) {
+        serve_error(fd, SERVE_BAD_REQUEST);
+        return -1;
+    }
     
-    Tableau* t = create_tableau(total_rows, total_cols);
+    double* data = (double*)(w->in + sizeof(req));
+    DietProblem problem = diet_problem_view((int)n, (int)m, data, data + n, data + n + n * m);
     
-    for (int i = 0; i < num_constraints; i++) {
-        for (int j = 0; j < num_foods; j++) {
-            t->matrix[i][j] = -foods[j].nutrients[i];
-        }
-        t->matrix[i][num_vars + i] = -1.0;
-        t->matrix[i][total_cols - 1] = -constraints[i];
-        t->basis[i] = num_vars + i;
+    SolverOptions opts = solver_options_default();
+    TableauSnapshots* snaps = &w->snapshots;
+    PivotTrace trace = { snapshot_tableau, snaps, 0 };
+    snaps->count = 0;
+    if ((req.flags & SERVE_TABLEAUX) && reserve_snapshots(snaps, (int)n, (int)m) == 0) {
+        opts.presolve = 0;
+        opts.scaling = 0;
+        opts.trace = &trace;
     }
+    Solution* sol = simplex_solve_in(w->ws, &problem, &opts);
+    if (!sol) return serve_error(fd, SERVE_FAILED);
     
-    for (int j = 0; j < num_foods; j++) {
-        t->matrix[total_rows - 1][j] = foods[j].cost;
+    ServeTableaux shape = { snaps->count, snaps->rows, snaps->cols, 0 };
+    size_t tableau_bytes = (size_t)snaps->count * snaps->rows * snaps->cols * sizeof(double);
+    size_t payload = sizeof(ServeResponse) + (n + m) * sizeof(double);
+    if (req.flags & SERVE_TABLEAUX) payload += sizeof(ServeTableaux) + tableau_bytes;
+    if (serve_reserve(&w->out, &w->out_size, sizeof(ServeHeader) + payload) != 0) {
+        return serve_error(fd, SERVE_FAILED);
     }
-    
-    if (verbose) {
-        printf("\nInitial Tableau:\n");
-        print_tableau(t);
+    ServeHeader header = { SERVE_MAGIC, (unsigned int)payload };
+    ServeResponse response = { sol->status, sol->iterations, (int)n, (int)m, sol->total_cost };
+    unsigned char* p = w->out;
+    memcpy(p, &header, sizeof(header));
+    p += sizeof(header);
+    memcpy(p, &response, sizeof(response));
+    p += sizeof(response);
+    memcpy(p, sol->amounts, n * sizeof(double));
+    p += n * sizeof(double);
+    memcpy(p, sol->shadow_prices, m * sizeof(double));
+    p += m * sizeof(double);
+    if (req.flags & SERVE_TABLEAUX) {
+        memcpy(p, &shape, sizeof(shape));
+        p += sizeof(shape);
+        memcpy(p, snaps->cells, tableau_bytes);
     }
-    
-    int iteration = 0;
-    int max_iterations = 100;
-    
-    while (iteration < max_iterations) {
-        int pivot_col = find_pivot_column(t);
-        
-        if (pivot_col == -1) {
-            if (verbose) printf("\nOptimal solution found!\n");
-            break;
-        }
-        
-        int pivot_row = find_pivot_row(t, pivot_col);
-        
-        if (pivot_row == -1) {
-            if (verbose) printf("\nProblem is unbounded!\n");
-            free_tableau(t);
-            return NULL;
-        }
-        
-        if (verbose) {
-            printf("\nIteration %d: Pivot at row %d, column %d\n", iteration + 1, pivot_row, pivot_col);
+    return write_full(fd, w->out, sizeof(ServeHeader) + payload);
+}
+
+static void serve_connection(ServeWorker* w, int fd) {
+    ServeHeader header;
+    while (read_full(fd, &header, sizeof(header)) == 0) {
+        if (header.magic != SERVE_MAGIC || header.bytes > SERVE_MAX_PAYLOAD) {
+            serve_error(fd, SERVE_BAD_REQUEST);
+            return;
         }
-        
-        pivot_operation(t, pivot_row, pivot_col);
-        
-        if (verbose) {
-            print_tableau(t);
+        if (serve_reserve(&w->in, &w->in_size, header.bytes ? header.bytes : 1) != 0) {
+            serve_error(fd, SERVE_FAILED);
+            return;
         }
-        
-        iteration++;
+        if (read_full(fd, w->in, header.bytes) != 0) return;
+        if (serve_request(w, fd, header.bytes) != 0) return;
     }
-    
-    Solution* sol = (Solution*)malloc(sizeof(Solution));
-    sol->amounts = (double*)calloc(num_foods, sizeof(double));
-    sol->shadow_prices = (double*)calloc(num_constraints, sizeof(double));
-    sol->feasible = 1;
-    
-    for (int j = 0; j < num_vars; j++) {
-        int is_basic = 0;
-        int basic_row = -1;
-        
-        for (int i = 0; i < num_constraints; i++) {
-            if (fabs(t->matrix[i][j] - 1.0) < EPSILON) {
-                int all_zero = 1;
-                for (int k = 0; k < num_constraints; k++) {
-                    if (k != i && fabs(t->matrix[k][j]) > EPSILON) {
-                        all_zero = 0;
-                        break;
-                    }
-                }
-                if (all_zero) {
-                    is_basic = 1;
-                    basic_row = i;
-                    break;
-                }
-            }
+}
+
+static void* serve_worker_main(void* arg) {
+    ServeWorker* w = (ServeWorker*)arg;
+    ServeQueue* q = w->queue;
+    for (;;) {
+        pthread_mutex_lock(&q->lock);
+        while (q->count == 0 && !q->stopping) pthread_cond_wait(&q->ready, &q->lock);
+        if (q->stopping) {
+            pthread_mutex_unlock(&q->lock);
+            break;
         }
+        int fd = q->fds[q->head];
+        q->head = (q->head + 1) % q->capacity;
+        q->count--;
+        w->fd = fd;
+        pthread_mutex_unlock(&q->lock);
         
-        if (is_basic && basic_row >= 0) {
-            sol->amounts[j] = fmax(0.0, t->matrix[basic_row][total_cols - 1]);
-        }
+        serve_connection(w, fd);
+        pthread_mutex_lock(&q->lock);
+        w->fd = -1;
+        pthread_mutex_unlock(&q->lock);
+        close(fd);
     }
-    
-    sol->total_cost = 0.0;
-    for (int j = 0; j < num_foods; j++) {
-        sol->total_cost += sol->amounts[j] * foods[j].cost;
+    return NULL;
+}
+
+/*
+ * Wakes every worker and ends its connection at the next read, so a solve in
+ * flight is still answered; joins the `started` threads, then closes whatever
+ * is still queued and frees the workers.
+ */
+static void stop_serve_workers(ServeQueue* q, ServeWorker* workers, pthread_t* threads, int started) {
+    pthread_mutex_lock(&q->lock);
+    q->stopping = 1;
+    for (int k = 0; k < started; k++) {
+        if (workers[k].fd >= 0) shutdown(workers[k].fd, SHUT_RD);
     }
-    
-    for (int i = 0; i < num_constraints; i++) {
-        sol->shadow_prices[i] = fabs(t->matrix[total_rows - 1][num_vars + i]);
+    pthread_cond_broadcast(&q->ready);
+    pthread_mutex_unlock(&q->lock);
+    for (int k = 0; k < started; k++) {
+        pthread_join(threads[k], NULL);
     }
     
-    free_tableau(t);
-    return sol;
+    for (; q->count > 0; q->count--) {
+        close(q->fds[q->head]);
+        q->head = (q->head + 1) % q->capacity;
+    }
+    for (int k = 0; k < started; k++) {
+        free_workspace(workers[k].ws);
+        free(workers[k].in);
+        free(workers[k].out);
+        free(workers[k].snapshots.cells);
+    }
 }
 
-void print_solution(Solution* sol, Food* foods, int num_foods, char** constraint_names, int num_constraints) {
-    if (!sol || !sol->feasible) {
-        printf("\nNo feasible solution found!\n");
-        return;
+static void set_idle_timeout(int fd, int timeout_ms) {
+    if (timeout_ms <= 0) return;
+    struct timeval tv = { timeout_ms / 1000, (timeout_ms % 1000) * 1000 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+/* Serves requests on `path` until opts->stop is raised; returns 1 if the service could not be set up. */
+int run_solver_service(const char* path, const ServeOptions* opts) {
+    int num_threads = opts->num_threads;
+    int queue_capacity = opts->queue_capacity;
+    struct sockaddr_un addr = { 0 };
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "socket path too long: %s\n", path);
+        return 1;
+    }
+    strcpy(addr.sun_path, path);
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path);
+    if (listener < 0 || bind(listener, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+        listen(listener, SOMAXCONN) != 0) {
+        fprintf(stderr, "cannot listen on %s: %s\n", path, strerror(errno));
+        if (listener >= 0) close(listener);
+        return 1;
     }
     
-    printf("\n");
-    printf("========================================\n");
-    printf("      OPTIMAL DIET SOLUTION\n");
-    printf("========================================\n");
-    printf("\nMinimum Daily Cost: $%.2f\n", sol->total_cost);
-    printf("\nFood Quantities:\n");
-    printf("----------------------------------------\n");
-    
-    for (int i = 0; i < num_foods; i++) {
-        if (sol->amounts[i] > EPSILON) {
-            printf("%-20s: %8.2f units ($%.2f)\n", 
-                   foods[i].name, 
-                   sol->amounts[i], 
-                   sol->amounts[i] * foods[i].cost);
+    ServeQueue queue = { 0 };
+    queue.fds = (int*)malloc(queue_capacity * sizeof(int));
+    queue.capacity = queue_capacity;
+    pthread_mutex_init(&queue.lock, NULL);
+    pthread_cond_init(&queue.ready, NULL);
+    ServeWorker* workers = (ServeWorker*)calloc(num_threads, sizeof(ServeWorker));
+    pthread_t* threads = (pthread_t*)malloc(num_threads * sizeof(pthread_t));
+    int started = 0;
+    int failed = !queue.fds || !workers || !threads;
+    while (!failed && started < num_threads) {
+        ServeWorker* w = &workers[started];
+        w->queue = &queue;
+        w->fd = -1;
+        w->ws = create_workspace(8, 5);
+        w->snapshots.ws = w->ws;
+        failed = !w->ws || pthread_create(&threads[started], NULL, serve_worker_main, w) != 0;
+        if (failed) {
+            free_workspace(w->ws);
+        } else {
+            started++;
         }
     }
-    
-    printf("\n========================================\n");
-    printf("      SHADOW PRICES (Dual Values)\n");
-    printf("========================================\n");
-    printf("\nMarginal value of each constraint:\n");
-    printf("----------------------------------------\n");
-    
-    for (int i = 0; i < num_constraints; i++) {
-        printf("%-20s: $%.6f per unit\n", 
-               constraint_names[i], 
-               sol->shadow_prices[i]);
+    if (failed) {
+        fprintf(stderr, "cannot start %d service workers\n", num_threads);
+    } else {
+        fprintf(stderr, "Serving on %s with %d threads, queue of %d\n", path, num_threads, queue_capacity);
     }
-    printf("\n");
-}
-
-void sensitivity_analysis(Solution* sol, Food* foods, int num_foods) {
-    printf("\n========================================\n");
-    printf("      SENSITIVITY ANALYSIS\n");
-    printf("========================================\n");
     
-    for (int i = 0; i < num_foods; i++) {
-        if (sol->amounts[i] > EPSILON) {
-            printf("\n%s (Current: $%.2f, Quantity: %.2f)\n", 
-                   foods[i].name, foods[i].cost, sol->amounts[i]);
-            printf("Price Change | New Price | Cost Impact\n");
-            printf("----------------------------------------\n");
-            
-            for (int pct = -50; pct <= 50; pct += 10) {
-                double new_price = foods[i].cost * (1.0 + pct / 100.0);
-                double impact = sol->amounts[i] * (new_price - foods[i].cost);
-                printf("%4d%%       | $%7.2f  | $%7.2f\n", pct, new_price, impact);
-            }
+    while (!failed && !(opts->stop && atomic_load(opts->stop))) {
+        struct pollfd ready = { listener, POLLIN, 0 };
+        if (poll(&ready, 1, opts->stop ? SERVE_POLL_MS : -1) <= 0) continue;
+        int fd = accept(listener, NULL, NULL);
+        if (fd < 0) continue;
+        set_idle_timeout(fd, opts->idle_timeout_ms);
+        pthread_mutex_lock(&queue.lock);
+        int full = queue.count == queue.capacity;
+        if (!full) {
+            queue.fds[(queue.head + queue.count) % queue.capacity] = fd;
+            queue.count++;
+            pthread_cond_signal(&queue.ready);
+        }
+        pthread_mutex_unlock(&queue.lock);
+        if (full) {
+            serve_error(fd, SERVE_BUSY);
+            close(fd);
         }
     }
-    printf("\n");
+    
+    if (workers && threads) stop_serve_workers(&queue, workers, threads, started);
+    close(listener);
+    unlink(path);
+    pthread_mutex_destroy(&queue.lock);
+    pthread_cond_destroy(&queue.ready);
+    free(queue.fds);
+    free(workers);
+    free(threads);
+    return failed;
+}
+
+#ifndef SIMPLEX_NO_MAIN
+static atomic_int serve_stop;
+
+/* SIGINT and SIGTERM let --serve join its workers and remove its socket. */
+static void request_serve_stop(int sig) {
+    (void)sig;
+    atomic_store(&serve_stop, 1);
 }
 
 int main(int argc, char** argv) {
@@ -285,6 +5981,28 @@ int main(int argc, char** argv) {
         {"Milk", 1.20, {8.0, 12.0, 8.0, 0.0, 50.0}}
     };
     
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        return run_benchmarks();
+    }
+    if (argc > 1 && strcmp(argv[1], "--bench-suite") == 0) {
+        return run_bench_suite(argc - 2, argv + 2);
+    }
+    if (argc > 1 && strncmp(argv[1], "--serve=", 8) == 0) {
+        ServeOptions serve = { (int)sysconf(_SC_NPROCESSORS_ONLN), 64, SERVE_IDLE_TIMEOUT_MS, &serve_stop };
+        for (int i = 2; i < argc; i++) {
+            if (strncmp(argv[i], "--threads=", 10) == 0) serve.num_threads = atoi(argv[i] + 10);
+            if (strncmp(argv[i], "--queue=", 8) == 0) serve.queue_capacity = atoi(argv[i] + 8);
+            if (strncmp(argv[i], "--idle-ms=", 10) == 0) serve.idle_timeout_ms = atoi(argv[i] + 10);
+        }
+        if (serve.num_threads < 1) serve.num_threads = 1;
+        if (serve.queue_capacity < 1) serve.queue_capacity = 1;
+        struct sigaction action = { 0 };
+        action.sa_handler = request_serve_stop;
+        sigaction(SIGINT, &action, NULL);
+        sigaction(SIGTERM, &action, NULL);
+        return run_solver_service(argv[1] + 8, &serve);
+    }
+    
     int num_foods = sizeof(foods) / sizeof(foods[0]);
     
     double constraints[] = {50.0, 130.0, 44.0, 25.0, 100.0};
@@ -298,7 +6016,29 @@ int main(int argc, char** argv) {
         "Vitamins (%DV)"
     };
     
-    int verbose = (argc > 1 && strcmp(argv[1], "-v") == 0);
+    SolverOptions opts = solver_options_default();
+    opts.ranging = 1;
+    int print_stats = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-v") == 0) opts.verbose = 1;
+        if (strcmp(argv[i], "--revised") == 0) opts.engine = ENGINE_REVISED;
+        if (strcmp(argv[i], "--textbook-ratio") == 0) opts.ratio_test = RATIO_TEXTBOOK;
+        if (strcmp(argv[i], "--no-scaling") == 0) opts.scaling = 0;
+        if (strcmp(argv[i], "--stats") == 0) print_stats = 1;
+        if (strncmp(argv[i], "--threads=", 10) == 0) opts.num_threads = atoi(argv[i] + 10);
+        if (strncmp(argv[i], "--max-iterations=", 17) == 0) opts.max_iterations = atoi(argv[i] + 17);
+        if (strncmp(argv[i], "--time-limit-ms=", 16) == 0) opts.time_limit_ns = atoll(argv[i] + 16) * 1000000LL;
+        for (int rule = 0; rule < NUM_PRICING_RULES; rule++) {
+            if (strncmp(argv[i], "--pricing=", 10) == 0 && strcmp(argv[i] + 10, pricing_names[rule]) == 0) {
+                opts.pricing = (PricingRule)rule;
+            }
+        }
+        for (int rule = DEGENERACY_PERTURB; rule <= DEGENERACY_NONE; rule++) {
+            if (strncmp(argv[i], "--degeneracy=", 13) == 0 && strcmp(argv[i] + 13, degeneracy_names[rule]) == 0) {
+                opts.degeneracy = (DegeneracyRule)rule;
+            }
+        }
+    }
     
     printf("\n");
     printf("╔════════════════════════════════════════════════════════╗\n");
@@ -316,16 +6056,31 @@ int main(int argc, char** argv) {
         printf("  %-20s: $%.2f\n", foods[i].name, foods[i].cost);
     }
     
-    Solution* sol = simplex_solve(foods, num_foods, constraints, num_constraints, verbose);
+    DietProblem* problem = diet_problem_from_foods(foods, num_foods, constraints, num_constraints);
+    for (int i = 0; problem && i < num_constraints; i++) {
+        if (set_nutrient_name(problem, i, constraint_names[i]) != 0) {
+            free_diet_problem(problem);
+            problem = NULL;
+        }
+    }
+    if (!problem) {
+        fprintf(stderr, "out of memory building the problem\n");
+        return 1;
+    }
+    
+    Solution* sol = simplex_solve(problem, &opts);
     
     if (sol) {
-        print_solution(sol, foods, num_foods, constraint_names, num_constraints);
-        sensitivity_analysis(sol, foods, num_foods);
-        
-        free(sol->amounts);
-        free(sol->shadow_prices);
-        free(sol);
+        print_solution(sol, problem);
+        if (sol->feasible) sensitivity_analysis(sol, problem);
+        if (print_stats) {
+            printf("Solve stats: ");
+            write_solve_stats_json(stdout, &sol->stats);
+        }
+        free_solution(sol);
     }
     
+    free_diet_problem(problem);
     return 0;
-}
\ No newline at end of file
+}
+#endif
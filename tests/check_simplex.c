@@ -0,0 +1,482 @@
+/*
+ * Checks for implementations/simplex.c, compiled in whole without its demo
+ * main:
+ *
+ *   gcc -O2 -pthread -D_POSIX_C_SOURCE=200809L tests/check_simplex.c -o check_simplex -lm
+ *   ./check_simplex tests/fixtures
+ *
+ * Every fixture is solved by both engines under every pricing rule, with and
+ * without presolve and scaling and on a sparse copy, and must match its
+ * reference status, optimal cost and, where they are unique, shadow prices.
+ * The references come from exact vertex enumeration over the rationals, not
+ * from this solver. A warm workspace must then solve each of them again, and
+ * a larger generated catalogue, without touching the heap, and the primal
+ * ratio tests must agree on hand-made columns. The solver service must answer
+ * good frames and refuse malformed ones. Prints one line per failure and
+ * exits nonzero if any.
+ */
+#define SIMPLEX_NO_MAIN
+#include <limits.h>
+#include "../implementations/simplex.c"
+
+#define CHECK_TOLERANCE 1e-7
+
+static const char* fixture_names[] = {
+    "diet", "two_foods", "degenerate", "infeasible", "magnitudes", "sparse"
+};
+
+typedef struct {
+    DietProblem* problem;
+    SolveStatus status;
+    double cost;
+    double* duals;      /* NULL when the optimal duals are not unique */
+} Fixture;
+
+static int failures;
+
+static void fail(const char* fixture, const char* variant, const char* what) {
+    printf("FAIL %-12s %-36s %s\n", fixture, variant, what);
+    failures++;
+}
+
+static int close_to(double value, double expected) {
+    return fabs(value - expected) <= CHECK_TOLERANCE * fmax(1.0, fabs(expected));
+}
+
+static int read_values(FILE* f, double* values, int count) {
+    for (int k = 0; k < count; k++) {
+        if (fscanf(f, "%lf", &values[k]) != 1) return -1;
+    }
+    return 0;
+}
+
+/*
+ * Lines of "keyword values...": foods and nutrients first, then costs,
+ * requirements, one food line per food, status, and for an optimum the cost
+ * and optionally the duals. '#' starts a comment line.
+ */
+static int load_fixture(const char* path, Fixture* fx) {
+    FILE* f = fopen(path, "r");
+    if (!f) return -1;
+    memset(fx, 0, sizeof(*fx));
+    int n = 0;
+    int m = 0;
+    int food = 0;
+    int ok = 1;
+    char key[32];
+    while (ok && fscanf(f, "%31s", key) == 1) {
+        if (key[0] == '#') {
+            int c;
+            while ((c = fgetc(f)) != EOF && c != '\n') {}
+        } else if (strcmp(key, "foods") == 0) {
+            ok = fscanf(f, "%d", &n) == 1 && n > 0;
+        } else if (strcmp(key, "nutrients") == 0) {
+            ok = fscanf(f, "%d", &m) == 1 && m > 0 && n > 0;
+            if (ok) fx->problem = create_diet_problem(n, m);
+            ok = ok && fx->problem;
+        } else if (!fx->problem) {
+            ok = 0;
+        } else if (strcmp(key, "costs") == 0) {
+            ok = read_values(f, fx->problem->costs, n) == 0;
+        } else if (strcmp(key, "requirements") == 0) {
+            ok = read_values(f, fx->problem->requirements, m) == 0;
+        } else if (strcmp(key, "food") == 0) {
+            ok = food < n && read_values(f, food_column(fx->problem, food++), m) == 0;
+        } else if (strcmp(key, "status") == 0) {
+            char status[32];
+            ok = fscanf(f, "%31s", status) == 1;
+            fx->status = strcmp(status, "optimal") == 0 ? SOLVE_OPTIMAL : SOLVE_INFEASIBLE;
+        } else if (strcmp(key, "cost") == 0) {
+            ok = fscanf(f, "%lf", &fx->cost) == 1;
+        } else if (strcmp(key, "duals") == 0) {
+            fx->duals = (double*)malloc(m * sizeof(double));
+            ok = fx->duals && read_values(f, fx->duals, m) == 0;
+        } else {
+            ok = 0;
+        }
+    }
+    fclose(f);
+    if (!ok || food != n) {
+        if (fx->problem) free_diet_problem(fx->problem);
+        free(fx->duals);
+        return -1;
+    }
+    return 0;
+}
+
+/* The solution against the reference, and the diet against the problem it claims to solve. */
+static void check_solution(const char* name, const char* variant, const Fixture* fx, const Solution* sol) {
+    const DietProblem* p = fx->problem;
+    char what[128];
+    if (!sol) {
+        fail(name, variant, "solve returned NULL");
+        return;
+    }
+    if (sol->status != fx->status) {
+        snprintf(what, sizeof(what), "status %s, expected %s", solve_status_name(sol->status),
+                 solve_status_name(fx->status));
+        fail(name, variant, what);
+        return;
+    }
+    if (fx->status != SOLVE_OPTIMAL) return;
+    
+    if (!close_to(sol->total_cost, fx->cost)) {
+        snprintf(what, sizeof(what), "cost %.12g, expected %.12g", sol->total_cost, fx->cost);
+        fail(name, variant, what);
+    }
+    double cost = 0.0;
+    for (int j = 0; j < p->num_foods; j++) {
+        if (sol->amounts[j] < -CHECK_TOLERANCE) fail(name, variant, "negative amount");
+        cost += p->costs[j] * sol->amounts[j];
+    }
+    if (!close_to(cost, sol->total_cost)) fail(name, variant, "total_cost does not price the amounts");
+    for (int i = 0; i < p->num_nutrients; i++) {
+        double intake = 0.0;
+        for (int j = 0; j < p->num_foods; j++) intake += food_column(p, j)[i] * sol->amounts[j];
+        if (intake < p->requirements[i] - CHECK_TOLERANCE * fmax(1.0, p->requirements[i])) {
+            snprintf(what, sizeof(what), "nutrient %d short: %.12g < %.12g", i, intake, p->requirements[i]);
+            fail(name, variant, what);
+        }
+        if (fx->duals && !close_to(sol->shadow_prices[i], fx->duals[i])) {
+            snprintf(what, sizeof(what), "shadow price %d is %.12g, expected %.12g", i, sol->shadow_prices[i],
+                     fx->duals[i]);
+            fail(name, variant, what);
+        }
+    }
+}
+
+static void check_fixture(const char* name, const Fixture* fx) {
+    static const char* engine_names[] = { "tableau", "revised" };
+    DietProblem* sparse = copy_diet_problem(fx->problem, 1);
+    for (int engine = ENGINE_TABLEAU; engine <= ENGINE_REVISED; engine++) {
+        for (int rule = 0; rule < NUM_PRICING_RULES; rule++) {
+            for (int pipeline = 0; pipeline < 3; pipeline++) {
+                static const char* pipeline_names[] = { "default", "plain", "sparse" };
+                SolverOptions opts = solver_options_default();
+                opts.engine = (SimplexEngine)engine;
+                opts.pricing = (PricingRule)rule;
+                if (pipeline == 1) {
+                    opts.presolve = 0;
+                    opts.scaling = 0;
+                }
+                char variant[64];
+                snprintf(variant, sizeof(variant), "%s/%s/%s", engine_names[engine], pricing_names[rule],
+                         pipeline_names[pipeline]);
+                Solution* sol = simplex_solve(pipeline == 2 ? sparse : fx->problem, &opts);
+                check_solution(name, variant, fx, sol);
+                if (sol) free_solution(sol);
+            }
+        }
+    }
+    free_diet_problem(sparse);
+}
+
+/* The primal and dual ratio tests on hand-made columns, including pivots below EPSILON. */
+static void check_ratio_tests(void) {
+    static const struct {
+        double x[3];
+        double alpha[3];
+        int pivot_row;
+    } cases[] = {
+        { { 5.0, 3.0, 0.0 }, { 1e-12, -1.0, 0.0 }, -1 },
+        { { 5.0, 3.0, 1.0 }, { 1e-12, 1e-9, -2.0 }, -1 },
+        { { 5.0, 3.0, 1.0 }, { 1e-12, 1.0, 0.5 }, 2 },
+        { { 0.0, 3.0, 1.0 }, { 1e-12, 1.0, 0.5 }, 2 }
+    };
+    for (size_t k = 0; k < sizeof(cases) / sizeof(cases[0]); k++) {
+        int harris = harris_ratio_test(cases[k].x, cases[k].alpha, 1, 3);
+        int textbook = textbook_ratio_test(cases[k].x, cases[k].alpha, 1, 3);
+        if (harris != cases[k].pivot_row || textbook != cases[k].pivot_row) {
+            char what[96];
+            snprintf(what, sizeof(what), "case %zu: harris row %d, textbook row %d, expected %d", k, harris,
+                     textbook, cases[k].pivot_row);
+            fail("ratio_test", "primal", what);
+        }
+    }
+    
+    /*
+     * Dual: |alpha| 5, 10, 1 in column order. The 1 sets the relaxed bound,
+     * which the 5 is within and the 10 is not, so Harris takes the 5.
+     */
+    static const struct {
+        double d[3];
+        double alpha[3];
+        int harris_col;
+        int textbook_col;
+    } dual_cases[] = {
+        { { 4.5e-9, 1.05e-8, 0.0 }, { -5.0, -10.0, -1.0 }, 0, 2 },
+        { { 1.0, 2.0, 3.0 }, { 1.0, -1e-12, 0.0 }, -1, -1 }
+    };
+    for (size_t k = 0; k < sizeof(dual_cases) / sizeof(dual_cases[0]); k++) {
+        int harris = harris_dual_ratio_test(dual_cases[k].d, dual_cases[k].alpha, 3);
+        int textbook = textbook_dual_ratio_test(dual_cases[k].d, dual_cases[k].alpha, 3);
+        if (harris != dual_cases[k].harris_col || textbook != dual_cases[k].textbook_col) {
+            char what[96];
+            snprintf(what, sizeof(what), "case %zu: harris column %d, textbook column %d, expected %d and %d", k,
+                     harris, textbook, dual_cases[k].harris_col, dual_cases[k].textbook_col);
+            fail("ratio_test", "dual", what);
+        }
+    }
+}
+
+/*
+ * After two solves of a problem under given options, further solves on the
+ * same workspace must take no heap blocks, whatever the engine and pricing.
+ */
+static void check_warm_workspace(const char* name, const DietProblem* problem) {
+    static const char* engine_names[] = { "tableau", "revised" };
+    SolverWorkspace* ws = create_workspace(problem->num_foods, problem->num_nutrients);
+    if (!ws) {
+        fail(name, "workspace", "create_workspace returned NULL");
+        return;
+    }
+    for (int engine = ENGINE_TABLEAU; engine <= ENGINE_REVISED; engine++) {
+        for (int rule = 0; rule < NUM_PRICING_RULES; rule++) {
+            SolverOptions opts = solver_options_default();
+            opts.engine = (SimplexEngine)engine;
+            opts.pricing = (PricingRule)rule;
+            simplex_solve_in(ws, problem, &opts);
+            simplex_solve_in(ws, problem, &opts);
+            long warm = workspace_heap_allocations(ws);
+            for (int k = 0; k < 10; k++) simplex_solve_in(ws, problem, &opts);
+            long allocations = workspace_heap_allocations(ws) - warm;
+            if (allocations != 0) {
+                char variant[64];
+                char what[64];
+                snprintf(variant, sizeof(variant), "warm/%s/%s", engine_names[engine], pricing_names[rule]);
+                snprintf(what, sizeof(what), "%ld heap allocations after warm-up", allocations);
+                fail(name, variant, what);
+            }
+        }
+    }
+    free_workspace(ws);
+}
+
+/* serve_connection on one end of a socket pair; the check talks to the other. */
+typedef struct {
+    ServeWorker worker;
+    int fd;
+} ServeEnd;
+
+static void* serve_end_main(void* arg) {
+    ServeEnd* end = (ServeEnd*)arg;
+    serve_connection(&end->worker, end->fd);
+    close(end->fd);
+    return NULL;
+}
+
+/*
+ * Sends one frame of `bytes` payload (the header claims `claimed` bytes) and
+ * reads the reply. Returns the reply status, with the solve's cost in *cost,
+ * or INT_MIN if the service closed the connection without one.
+ */
+static int serve_exchange(int fd, unsigned int magic, unsigned int claimed, const void* payload, size_t bytes,
+                          double* cost) {
+    ServeHeader header = { magic, claimed };
+    if (write_full(fd, &header, sizeof(header)) != 0 || write_full(fd, payload, bytes) != 0) return INT_MIN;
+    ServeResponse response;
+    if (read_full(fd, &header, sizeof(header)) != 0 || header.bytes < sizeof(response) ||
+        read_full(fd, &response, sizeof(response)) != 0) {
+        return INT_MIN;
+    }
+    size_t rest = header.bytes - sizeof(response);
+    unsigned char sink[256];
+    while (rest) {
+        size_t chunk = rest < sizeof(sink) ? rest : sizeof(sink);
+        if (read_full(fd, sink, chunk) != 0) return INT_MIN;
+        rest -= chunk;
+    }
+    *cost = response.total_cost;
+    return response.status;
+}
+
+/* The request payload for a dense problem; *bytes is its size. */
+static unsigned char* serve_request_payload(const DietProblem* p, size_t* bytes) {
+    int n = p->num_foods;
+    int m = p->num_nutrients;
+    *bytes = sizeof(ServeRequest) + (size_t)(n + n * m + m) * sizeof(double);
+    unsigned char* payload = (unsigned char*)malloc(*bytes);
+    ServeRequest req = { n, m, 0, 0 };
+    memcpy(payload, &req, sizeof(req));
+    double* data = (double*)(payload + sizeof(req));
+    memcpy(data, p->costs, n * sizeof(double));
+    memcpy(data + n, p->nutrients, (size_t)n * m * sizeof(double));
+    memcpy(data + n + n * m, p->requirements, m * sizeof(double));
+    return payload;
+}
+
+static void check_service_frames(const Fixture* fx) {
+    int n = fx->problem->num_foods;
+    int m = fx->problem->num_nutrients;
+    size_t good_bytes;
+    unsigned char* good = serve_request_payload(fx->problem, &good_bytes);
+    
+    /* 2147352579 + 2147352579 * 1073807361 + 1073807361 doubles wrap around to 7. */
+    unsigned char wrapped[sizeof(ServeRequest) + 7 * sizeof(double)] = { 0 };
+    ServeRequest huge = { 2147352579, 1073807361, 0, 0 };
+    memcpy(wrapped, &huge, sizeof(huge));
+    ServeRequest short_m = { n, m - 1, 0, 0 };
+    unsigned char mismatched[sizeof(ServeRequest)];
+    memcpy(mismatched, &short_m, sizeof(short_m));
+    
+    static const struct {
+        const char* name;
+        int frame;          /* 0 good, 1 wrapped, 2 mismatched */
+        unsigned int magic;
+        int claim;          /* 0 the payload size, 1 past SERVE_MAX_PAYLOAD, 2 shorter than ServeRequest */
+        int status;
+    } cases[] = {
+        { "good", 0, SERVE_MAGIC, 0, SOLVE_OPTIMAL },
+        { "bad magic", 0, 0x12345678u, 0, SERVE_BAD_REQUEST },
+        { "oversized", 0, SERVE_MAGIC, 1, SERVE_BAD_REQUEST },
+        { "truncated", 0, SERVE_MAGIC, 2, SERVE_BAD_REQUEST },
+        { "size mismatch", 2, SERVE_MAGIC, 0, SERVE_BAD_REQUEST },
+        { "size overflow", 1, SERVE_MAGIC, 0, SERVE_BAD_REQUEST }
+    };
+    for (size_t k = 0; k < sizeof(cases) / sizeof(cases[0]); k++) {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+            fail("service", cases[k].name, "socketpair failed");
+            break;
+        }
+        ServeEnd end = { { 0 }, fds[1] };
+        end.worker.ws = create_workspace(n, m);
+        end.worker.snapshots.ws = end.worker.ws;
+        pthread_t thread;
+        pthread_create(&thread, NULL, serve_end_main, &end);
+        
+        const void* payload = cases[k].frame == 1 ? (const void*)wrapped
+                            : cases[k].frame == 2 ? (const void*)mismatched : (const void*)good;
+        size_t bytes = cases[k].frame == 1 ? sizeof(wrapped) : cases[k].frame == 2 ? sizeof(mismatched) : good_bytes;
+        if (cases[k].claim == 2) bytes = sizeof(ServeRequest) / 2;
+        unsigned int claimed = cases[k].claim == 1 ? SERVE_MAX_PAYLOAD + 8 : (unsigned int)bytes;
+        if (cases[k].claim == 1) bytes = 0;
+        double cost = NAN;
+        int status = serve_exchange(fds[0], cases[k].magic, claimed, payload, bytes, &cost);
+        char what[96];
+        if (status != cases[k].status) {
+            snprintf(what, sizeof(what), "status %d, expected %d", status, cases[k].status);
+            fail("service", cases[k].name, what);
+        } else if (status == SOLVE_OPTIMAL) {
+            if (!close_to(cost, fx->cost)) fail("service", cases[k].name, "wrong cost");
+            /* A good request keeps the connection open for the next one. */
+            status = serve_exchange(fds[0], SERVE_MAGIC, (unsigned int)good_bytes, good, good_bytes, &cost);
+            if (status != SOLVE_OPTIMAL) fail("service", cases[k].name, "second request on the connection failed");
+        } else if (recv(fds[0], what, 1, 0) > 0) {
+            fail("service", cases[k].name, "connection left open after a malformed frame");
+        }
+        shutdown(fds[0], SHUT_WR);
+        pthread_join(thread, NULL);
+        close(fds[0]);
+        free_workspace(end.worker.ws);
+        free(end.worker.in);
+        free(end.worker.out);
+        free(end.worker.snapshots.cells);
+    }
+    free(good);
+}
+
+typedef struct {
+    const char* path;
+    ServeOptions opts;
+    int result;
+} ServiceRun;
+
+static void* service_main(void* arg) {
+    ServiceRun* run = (ServiceRun*)arg;
+    run->result = run_solver_service(run->path, &run->opts);
+    return NULL;
+}
+
+/* A client connection with a 5 s timeout, retried while the service starts up; -1 if none. */
+static int connect_service(const char* path) {
+    struct sockaddr_un addr = { 0 };
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+    for (int attempt = 0; attempt < 200; attempt++) {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd >= 0 && connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0) {
+            set_idle_timeout(fd, 5000);
+            return fd;
+        }
+        if (fd >= 0) close(fd);
+        struct timespec pause = { 0, 10000000 };
+        nanosleep(&pause, NULL);
+    }
+    return -1;
+}
+
+/*
+ * The whole service on one worker: a silent client is dropped after the idle
+ * timeout so a queued one gets served, and raising the stop flag returns from
+ * run_solver_service with a connection still open.
+ */
+static void check_service_lifecycle(const Fixture* fx) {
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/check_simplex_%d.sock", (int)getpid());
+    atomic_int stop;
+    atomic_init(&stop, 0);
+    ServiceRun run = { path, { 1, 4, 300, &stop }, -1 };
+    pthread_t thread;
+    pthread_create(&thread, NULL, service_main, &run);
+    
+    size_t bytes;
+    unsigned char* payload = serve_request_payload(fx->problem, &bytes);
+    double cost = NAN;
+    char byte;
+    int idle = connect_service(path);
+    int queued = connect_service(path);
+    if (idle < 0 || queued < 0) {
+        fail("service", "lifecycle", "cannot connect");
+    } else {
+        int status = serve_exchange(queued, SERVE_MAGIC, (unsigned int)bytes, payload, bytes, &cost);
+        if (status != SOLVE_OPTIMAL || !close_to(cost, fx->cost)) {
+            fail("service", "idle timeout", "queued request not served while a client sat idle");
+        }
+        if (recv(idle, &byte, 1, 0) > 0) fail("service", "idle timeout", "idle connection not dropped");
+    }
+    
+    int open = connect_service(path);
+    if (open < 0 || serve_exchange(open, SERVE_MAGIC, (unsigned int)bytes, payload, bytes, &cost) != SOLVE_OPTIMAL) {
+        fail("service", "stop", "request before stop failed");
+    }
+    atomic_store(&stop, 1);
+    pthread_join(thread, NULL);
+    if (run.result != 0) fail("service", "stop", "run_solver_service did not return 0");
+    if (open >= 0 && recv(open, &byte, 1, 0) > 0) fail("service", "stop", "connection left open after stop");
+    if (access(path, F_OK) == 0) fail("service", "stop", "socket file left behind");
+    
+    if (idle >= 0) close(idle);
+    if (queued >= 0) close(queued);
+    if (open >= 0) close(open);
+    free(payload);
+}
+
+int main(int argc, char** argv) {
+    const char* dir = argc > 1 ? argv[1] : "tests/fixtures";
+    check_ratio_tests();
+    int num_fixtures = (int)(sizeof(fixture_names) / sizeof(fixture_names[0]));
+    for (int k = 0; k < num_fixtures; k++) {
+        char path[512];
+        Fixture fx;
+        snprintf(path, sizeof(path), "%s/%s.txt", dir, fixture_names[k]);
+        if (load_fixture(path, &fx) != 0) {
+            fail(fixture_names[k], path, "cannot load fixture");
+            continue;
+        }
+        check_fixture(fixture_names[k], &fx);
+        check_warm_workspace(fixture_names[k], fx.problem);
+        if (k == 0) {
+            check_service_frames(&fx);
+            check_service_lifecycle(&fx);
+        }
+        free_diet_problem(fx.problem);
+        free(fx.duals);
+    }
+    DietProblem* catalogue = generate_catalogue(200, 20, 0.3, 13);
+    check_warm_workspace("catalogue", catalogue);
+    free_diet_problem(catalogue);
+    
+    printf("%s: %d failure%s\n", failures ? "FAILED" : "ok", failures, failures == 1 ? "" : "s");
+    return failures != 0;
+}